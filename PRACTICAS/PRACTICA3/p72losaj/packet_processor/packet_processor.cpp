@@ -1,3 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <thread>
+
 #include "packet_processor.hpp"
 
 PacketProcessor::PacketProcessor(size_t size)
@@ -66,6 +74,156 @@ PacketProcessor::process(const Packet &packet)
 }
 
 
+QoSPacketProcessor::QoSPacketProcessor(size_t size, SchedulingPolicy policy,
+                                       const std::vector <int> &quantums):
+    size_(size), policy_(policy), quantums_(quantums),
+    queues_(quantums.size()), deficits_(quantums.size(), 0),
+    red_enabled_(quantums.size(), false), red_(quantums.size()),
+    red_avg_(quantums.size(), 0.0), rng_(1),
+    drr_class_(0), drr_fresh_(true), queued_(0), busy_until_(0)
+{
+    assert(size > 0);
+    assert(quantums.size() > 0);
+    for (size_t c = 0; c < quantums_.size(); ++c)
+        assert(quantums_[c] > 0);
+}
+
+void
+QoSPacketProcessor::set_early_drop(size_t traffic_class, const RedParameters &params)
+{
+    assert(traffic_class < n_classes());
+    assert(params.min_threshold < params.max_threshold);
+    assert(params.weight > 0.0 && params.weight <= 1.0);
+    red_enabled_[traffic_class] = true;
+    red_[traffic_class] = params;
+}
+
+size_t
+QoSPacketProcessor::n_classes() const
+{
+    return queues_.size();
+}
+
+std::vector <Response>
+QoSPacketProcessor::process(const std::vector <Packet> &packets)
+{
+    std::vector <Response> responses(packets.size(), Response(true, 0));
+
+    for (size_t c = 0; c < queues_.size(); ++c)
+    {
+        queues_[c].clear();
+        deficits_[c] = 0;
+        red_avg_[c] = 0.0;
+    }
+    rng_.seed(1);
+    drr_class_ = 0;
+    drr_fresh_ = true;
+    queued_ = 0;
+    busy_until_ = 0;
+
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        const Packet &packet = packets[i];
+        assert(i == 0 || packets[i-1].arrival_time <= packet.arrival_time);
+
+        // 1. El procesador atiende los paquetes encolados hasta la llegada.
+        dispatch_until(packet.arrival_time, packets, responses);
+
+        // 2. Clasificamos el paquete (en FIFO hay una sola cola).
+        size_t tc = std::min(packet.traffic_class, n_classes()-1);
+        size_t c = (policy_ == SchedulingPolicy::FIFO) ? 0 : tc;
+
+        // 3. Tail drop si el buffer está lleno, sino RED.
+        size_t in_system = queued_ + (busy_until_ > packet.arrival_time ? 1 : 0);
+        if (in_system >= size_ || early_drop(tc))
+            continue;
+
+        queues_[c].push_back(i);
+        ++queued_;
+
+        // 4. Si el procesador está libre, empieza inmediatamente.
+        dispatch_until(packet.arrival_time, packets, responses);
+    }
+    dispatch_until(std::numeric_limits <long>::max(), packets, responses);
+    assert(queued_ == 0);
+    return responses;
+}
+
+void
+QoSPacketProcessor::dispatch_until(long t, const std::vector <Packet> &packets,
+                                   std::vector <Response> &responses)
+{
+    while (queued_ > 0 && busy_until_ <= t)
+    {
+        size_t c = select_class(packets);
+        size_t i = queues_[c].front();
+        queues_[c].pop_front();
+        --queued_;
+
+        long start = std::max <long>(busy_until_, packets[i].arrival_time);
+        responses[i] = Response(false, static_cast <int>(start));
+        busy_until_ = start + packets[i].process_time;
+    }
+}
+
+size_t
+QoSPacketProcessor::select_class(const std::vector <Packet> &packets)
+{
+    assert(queued_ > 0);
+    if (policy_ != SchedulingPolicy::DRR)
+    {
+        size_t c = 0;
+        while (queues_[c].empty())
+            ++c;
+        return c;
+    }
+
+    // Deficit round robin: cada visita a una cola no vacía suma su quantum
+    // al déficit y se sirve mientras el coste del primero no lo supere.
+    while (true)
+    {
+        std::deque <size_t> &q = queues_[drr_class_];
+        if (q.empty())
+            deficits_[drr_class_] = 0;
+        else
+        {
+            if (drr_fresh_)
+            {
+                deficits_[drr_class_] += quantums_[drr_class_];
+                drr_fresh_ = false;
+            }
+            long cost = packets[q.front()].process_time;
+            if (cost <= deficits_[drr_class_])
+            {
+                deficits_[drr_class_] -= cost;
+                return drr_class_;
+            }
+        }
+        drr_class_ = (drr_class_ + 1) % queues_.size();
+        drr_fresh_ = true;
+    }
+}
+
+bool
+QoSPacketProcessor::early_drop(size_t c)
+{
+    if (!red_enabled_[c])
+        return false;
+
+    const RedParameters &red = red_[c];
+    red_avg_[c] = (1.0 - red.weight) * red_avg_[c] + red.weight * queued_;
+
+    if (red_avg_[c] < red.min_threshold)
+        return false;
+    if (red_avg_[c] >= red.max_threshold)
+        return true;
+
+    double p = red.max_probability * (red_avg_[c] - red.min_threshold) /
+               (red.max_threshold - red.min_threshold);
+    std::uniform_real_distribution <double> u(0.0, 1.0);
+    return u(rng_) < p;
+}
+
 /** @brief process the packets and generate a response for each of them.*/
 std::vector <Response>
 process_packets(const std::vector <Packet> &packets,
@@ -77,6 +235,113 @@ process_packets(const std::vector <Packet> &packets,
     return responses;
 }
 
+std::vector <Response>
+process_packets(const std::vector <Packet> &packets, size_t size, size_t workers)
+{
+    assert(size > 0);
+    assert(workers > 0);
+
+    typedef std::priority_queue <long, std::vector <long>, std::greater <long> > MinHeap;
+    std::vector <long> zeros(workers, 0);
+    MinHeap free_at(std::greater <long>(), zeros); //when each worker gets free.
+    MinHeap finish_at;                             //finish times of the buffered packets.
+
+    std::vector <Response> responses;
+    responses.reserve(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        const Packet &packet = packets[i];
+        while (!finish_at.empty() && finish_at.top() <= packet.arrival_time)
+            finish_at.pop();
+
+        if (finish_at.size() >= size)
+            responses.push_back(Response(true, 0));
+        else
+        {
+            long start = std::max <long>(packet.arrival_time, free_at.top());
+            free_at.pop();
+            free_at.push(start + packet.process_time);
+            finish_at.push(start + packet.process_time);
+            responses.push_back(Response(false, static_cast <int>(start)));
+        }
+    }
+    return responses;
+}
+
+/** @brief Run a configuration and summarize it.*/
+static SweepResult
+run_configuration(const std::vector <Packet> &packets, size_t size, size_t workers)
+{
+    SweepResult result(size, workers);
+    std::vector <Response> responses = process_packets(packets, size, workers);
+
+    double total = 0.0;
+    for (size_t i = 0; i < responses.size(); ++i)
+        if (responses[i].dropped)
+            ++result.dropped;
+        else
+        {
+            int latency = responses[i].start_time - packets[i].arrival_time;
+            total += latency;
+            result.max_latency = std::max(result.max_latency, latency);
+        }
+
+    size_t processed = packets.size() - result.dropped;
+    if (!packets.empty())
+        result.drop_rate = static_cast <double>(result.dropped) / packets.size();
+    if (processed > 0)
+    {
+        result.mean_latency = total / processed;
+        result.p99_latency = latency_percentile(packets, responses, -1, 99.0);
+    }
+    return result;
+}
+
+std::vector <SweepResult>
+sweep_packet_processor(const std::vector <Packet> &packets,
+                       const std::vector <size_t> &sizes,
+                       const std::vector <size_t> &workers,
+                       size_t n_threads)
+{
+    std::vector <SweepResult> results;
+    for (size_t s = 0; s < sizes.size(); ++s)
+        for (size_t w = 0; w < workers.size(); ++w)
+            results.push_back(SweepResult(sizes[s], workers[w]));
+
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min(n_threads, results.size());
+
+    // Cada hilo toma la siguiente configuración libre hasta agotarlas.
+    std::atomic <size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < results.size(); i = next++)
+            results[i] = run_configuration(packets, results[i].size, results[i].workers);
+    };
+
+    std::vector <std::thread> threads;
+    for (size_t t = 1; t < n_threads; ++t)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    return results;
+}
+
+std::ostream&
+write_sweep_table(std::ostream &out, const std::vector <SweepResult> &results)
+{
+    out << "size\tworkers\tdropped\tdrop_rate\tmean_latency\tp99_latency\tmax_latency" << std::endl;
+    for (size_t i = 0; i < results.size(); ++i)
+        out << results[i].size << '\t' << results[i].workers << '\t'
+            << results[i].dropped << '\t' << results[i].drop_rate << '\t'
+            << results[i].mean_latency << '\t' << results[i].p99_latency << '\t'
+            << results[i].max_latency << std::endl;
+    return out;
+}
+
 /** @brief print the processing start times for the packets.*/
 std::ostream&
 write_responses(std::ostream &out, const std::vector <Response> &responses)
@@ -85,3 +350,43 @@ write_responses(std::ostream &out, const std::vector <Response> &responses)
         out << (responses[i].dropped ? -1 : responses[i].start_time) << std::endl;
     return out;
 }
+
+int
+latency_percentile(const std::vector <Packet> &packets,
+                   const std::vector <Response> &responses,
+                   int traffic_class, double percentile)
+{
+    assert(packets.size() == responses.size());
+    assert(percentile >= 0.0 && percentile <= 100.0);
+
+    std::vector <int> latencies;
+    for (size_t i = 0; i < packets.size(); ++i)
+        if (!responses[i].dropped &&
+            (traffic_class < 0 || packets[i].traffic_class == static_cast <size_t>(traffic_class)))
+            latencies.push_back(responses[i].start_time - packets[i].arrival_time);
+
+    if (latencies.empty())
+        return -1;
+
+    size_t k = static_cast <size_t>(percentile / 100.0 * (latencies.size() - 1) + 0.5);
+    std::nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+    return latencies[k];
+}
+
+double
+drop_rate(const std::vector <Packet> &packets,
+          const std::vector <Response> &responses,
+          int traffic_class)
+{
+    assert(packets.size() == responses.size());
+
+    size_t total = 0, dropped = 0;
+    for (size_t i = 0; i < packets.size(); ++i)
+        if (traffic_class < 0 || packets[i].traffic_class == static_cast <size_t>(traffic_class))
+        {
+            ++total;
+            if (responses[i].dropped)
+                ++dropped;
+        }
+    return total == 0 ? 0.0 : static_cast <double>(dropped) / total;
+}
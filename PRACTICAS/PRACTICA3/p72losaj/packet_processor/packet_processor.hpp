@@ -3,24 +3,30 @@
 
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <random>
 
 #include "queue.hpp"
 
 /** @brief Models a Packet.
- * We are only interesed in the arrival time and
- * how much time is spent to be processed.
+ * We are only interesed in the arrival time,
+ * how much time is spent to be processed and its traffic class.
+ * The traffic class is only used by the QoS policies (0 is the most
+ * priority class).
 */
 struct Packet {
     Packet():
-        arrival_time(0), process_time(0)
+        arrival_time(0), process_time(0), traffic_class(0)
     {}
-    Packet(int arrival_time, int process_time):
+    Packet(int arrival_time, int process_time, size_t traffic_class=0):
         arrival_time(arrival_time),
-        process_time(process_time)
+        process_time(process_time),
+        traffic_class(traffic_class)
     {}
 
     int arrival_time;
     int process_time;
+    size_t traffic_class;
 };
 
 /** @brief Models the response to a incomming packet.
@@ -63,10 +69,169 @@ protected:
     
 };
 
+/** @brief Scheduling policies of the QoS packet processor.*/
+enum class SchedulingPolicy
+{
+    FIFO,      /**< Arrival order (same responses as PacketProcessor).*/
+    PRIORITY,  /**< Strict priority: the lowest traffic class is served first.*/
+    DRR        /**< Deficit round robin (weighted fair queueing).*/
+};
+
+/** @brief Parameters of the RED (random early detection) drop policy.
+ * The average occupancy of the buffer is computed as an exponential
+ * weighted moving average. Below min_threshold no packet is early dropped,
+ * over max_threshold all packets are dropped and in between a packet is
+ * dropped with a probability that grows linearly up to max_probability.
+ * The thresholds are numbers of queued packets and the defaults are the
+ * classic 5 and 15 packets.
+ * @pre min_threshold < max_threshold
+*/
+struct RedParameters
+{
+    RedParameters(double min_threshold=5.0, double max_threshold=15.0,
+                  double max_probability=0.1, double weight=0.2):
+        min_threshold(min_threshold),
+        max_threshold(max_threshold),
+        max_probability(max_probability),
+        weight(weight)
+    {}
+
+    double min_threshold;
+    double max_threshold;
+    double max_probability;
+    double weight;
+};
+
+/** @brief Models a packet processor with QoS policies.
+ * Packets are classified by their traffic class into one queue per class.
+ * The queues share a buffer of at most size packets (the packet being
+ * processed included, as in PacketProcessor).
+ *
+ * Unlike PacketProcessor, the start time of a queued packet depends on the
+ * packets that will arrive later, so the whole trace is processed at once.
+ * The packets must be sorted by arrival time.
+*/
+class QoSPacketProcessor
+{
+public:
+    /**
+     * @brief Create a QoS packet processor.
+     * @arg size is the buffer size shared by all the classes.
+     * @arg policy is the scheduling policy.
+     * @arg quantums are the DRR quantums (in process time units) per class.
+     *      Its size fixes the number of traffic classes.
+     * @pre size > 0
+     * @pre quantums.size() > 0 and every quantum > 0
+     */
+    QoSPacketProcessor(size_t size, SchedulingPolicy policy,
+                       const std::vector <int> &quantums = std::vector <int>(1, 1));
+
+    /**
+     * @brief Enable the RED early drop for a traffic class.
+     * @pre traffic_class < n_classes()
+     * @pre params.min_threshold < params.max_threshold
+     * @pre 0 < params.weight <= 1
+     */
+    void set_early_drop(size_t traffic_class, const RedParameters &params);
+
+    /** @brief Get the number of traffic classes.*/
+    size_t n_classes() const;
+
+    /**
+     * @brief generate the responses for a trace of packets.
+     * Packets with a traffic class out of range are processed as the
+     * lowest priority class.
+     * @pre the packets are sorted by arrival time.
+     */
+    std::vector <Response> process(const std::vector <Packet> &packets);
+
+protected:
+
+    /** @brief Dispatch queued packets while the processor is free at time t.*/
+    void dispatch_until(long t, const std::vector <Packet> &packets,
+                        std::vector <Response> &responses);
+
+    /** @brief Select the class of the next packet to process.
+     * @pre queued_ > 0
+     */
+    size_t select_class(const std::vector <Packet> &packets);
+
+    /** @brief Must the packet be early dropped?*/
+    bool early_drop(size_t c);
+
+    size_t size_;
+    SchedulingPolicy policy_;
+    std::vector <int> quantums_;
+    std::vector <std::deque <size_t> > queues_; //indexes of queued packets.
+    std::vector <long> deficits_;
+    std::vector <bool> red_enabled_;
+    std::vector <RedParameters> red_;
+    std::vector <double> red_avg_;
+    std::minstd_rand rng_;
+    size_t drr_class_;
+    bool drr_fresh_;
+    size_t queued_;
+    long busy_until_;
+};
+
 /** @brief process the packets and generate a response for each of them.*/
 std::vector <Response> process_packets(const std::vector <Packet> &packets,
                 PacketProcessor& p);
 
+/** @brief Compute a percentile of the waiting time of the processed packets.
+ * The waiting time is start_time - arrival_time. Dropped packets are ignored.
+ * @arg traffic_class filters by traffic class, use -1 for all the packets.
+ * @arg percentile is in [0, 100].
+ * @return the percentile or -1 if there is not any processed packet.
+ */
+int latency_percentile(const std::vector <Packet> &packets,
+                       const std::vector <Response> &responses,
+                       int traffic_class, double percentile);
+
+/** @brief Get the drop rate [0, 1] of a traffic class (-1 for all the packets).*/
+double drop_rate(const std::vector <Packet> &packets,
+                 const std::vector <Response> &responses,
+                 int traffic_class);
+
+/** @brief Summary of a processor configuration run over a trace.*/
+struct SweepResult
+{
+    SweepResult(size_t size=0, size_t workers=0):
+        size(size), workers(workers), dropped(0), drop_rate(0.0),
+        mean_latency(0.0), p99_latency(-1), max_latency(-1)
+    {}
+
+    size_t size;
+    size_t workers;
+    size_t dropped;
+    double drop_rate;
+    double mean_latency;
+    int p99_latency;
+    int max_latency;
+};
+
+/** @brief process the packets by a FIFO processor with several workers.
+ * The buffer holds at most size packets, the ones being processed included,
+ * so for workers == 1 the responses are the same as PacketProcessor(size).
+ * @pre size > 0 and workers > 0
+ * @pre the packets are sorted by arrival time.
+ */
+std::vector <Response> process_packets(const std::vector <Packet> &packets,
+                                       size_t size, size_t workers);
+
+/** @brief Evaluate a trace for every pair (size, workers).
+ * The trace is shared by all the configurations, which are run in parallel
+ * using n_threads threads (0 means the hardware concurrency).
+ * @return a result for each configuration, ordered by size and workers.
+ */
+std::vector <SweepResult> sweep_packet_processor(const std::vector <Packet> &packets,
+                                                 const std::vector <size_t> &sizes,
+                                                 const std::vector <size_t> &workers,
+                                                 size_t n_threads = 0);
+
+/** @brief print the sweep results as a table (one configuration per line).*/
+std::ostream& write_sweep_table(std::ostream& out, const std::vector <SweepResult> &results);
+
 /** @brief print the processing start times for the packets.*/
 std::ostream& write_responses(std::ostream& out, const std::vector <Response> &responses);
 
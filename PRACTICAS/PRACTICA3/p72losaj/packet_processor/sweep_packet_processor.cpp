@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "packet_processor.hpp"
+#include "bench_utils.hpp"
+
+/** @brief Evaluate a packet trace for several buffer sizes and workers.
+ * The trace is read once from the standard input as a list of
+ * "arrival_time process_time" pairs.
+ */
+int
+main(int argc, char* argv[])
+{
+    std::vector <size_t> sizes, workers;
+    size_t n_threads = 0;
+
+    bool ok = argc >= 2 && argc <= 4 && parse_list(argv[1], sizes);
+    if (ok && argc > 2)
+        ok = parse_list(argv[2], workers);
+    else
+        workers.push_back(1);
+    if (!ok)
+    {
+        std::cerr << "Usage: " << argv[0] << " size[,size...] [workers[,workers...]] [threads] < trace"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (argc > 3)
+        n_threads = static_cast <size_t>(std::atol(argv[3]));
+
+    std::vector <Packet> packets;
+    int arrival_time, process_time;
+    while (std::cin >> arrival_time >> process_time)
+        packets.push_back(Packet(arrival_time, process_time));
+
+    write_sweep_table(std::cout, sweep_packet_processor(packets, sizes, workers, n_threads));
+    return EXIT_SUCCESS;
+}
@@ -129,7 +129,7 @@ public:
     {
         //TODO
         
-        izquierdo == new_child;
+        izquierdo = new_child;
 
     }
 
@@ -164,7 +164,7 @@ public:
     {
         //TODO
 
-        right.reset();
+        derecha.reset();
     }
 
 protected:
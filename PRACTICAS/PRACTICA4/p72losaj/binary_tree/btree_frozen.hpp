@@ -0,0 +1,318 @@
+#ifndef __ED_BTree_Frozen_HPP__
+#define __ED_BTree_Frozen_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "btree.hpp"
+
+/** @brief Storage of a FrozenBTree node.*/
+template <class T>
+struct FrozenBTSlot
+{
+    typedef std::uint32_t Index;
+
+    T item;
+    Index left;
+    Index right;
+};
+
+/**
+ * @brief a read only reference to a FrozenBTree's Node.
+ * It offers the same observers as BTNode<T> and operator-> returns the
+ * reference itself, so code written as node->left() works with both.
+ */
+template <class T>
+class FrozenBTNode
+{
+public:
+
+    /** @brief Index of a node into the array.*/
+    typedef typename FrozenBTSlot<T>::Index Index;
+
+    /** @brief Index used as null link.*/
+    static const Index null_index = std::numeric_limits<Index>::max();
+
+    /** @brief A reference to a node is the handle itself.*/
+    typedef FrozenBTNode<T> Ref;
+
+    /** @brief Create a null reference.*/
+    FrozenBTNode (std::nullptr_t = nullptr):
+        nodes_(nullptr), index_(null_index)
+    {}
+
+    /** @brief Create a reference to a node of an array.*/
+    FrozenBTNode (FrozenBTSlot<T> const* nodes, Index index):
+        nodes_(nodes), index_(index)
+    {}
+
+    /** @brief Is it a null reference?*/
+    bool is_null() const
+    {
+        return index_ == null_index;
+    }
+
+    /** @brief Get the position of the node into the array.*/
+    Index index() const
+    {
+        return index_;
+    }
+
+    /** @brief Get the data item.*/
+    const T& item() const
+    {
+        assert(!is_null());
+        return nodes_[index_].item;
+    }
+
+    /** @brief Has it a left child?*/
+    bool has_left() const
+    {
+        assert(!is_null());
+        return nodes_[index_].left != null_index;
+    }
+
+    /** @brief get the left child.*/
+    Ref left() const
+    {
+        assert(!is_null());
+        return Ref(nodes_, nodes_[index_].left);
+    }
+
+    /** @brief Has it a right child? */
+    bool has_right() const
+    {
+        assert(!is_null());
+        return nodes_[index_].right != null_index;
+    }
+
+    /** @brief get the right child.*/
+    Ref right() const
+    {
+        assert(!is_null());
+        return Ref(nodes_, nodes_[index_].right);
+    }
+
+    /** @brief Access to the node as a BTNode<T>::Ref does.*/
+    const Ref* operator->() const
+    {
+        return this;
+    }
+
+    /** @brief Is this reference null?*/
+    explicit operator bool() const
+    {
+        return !is_null();
+    }
+
+    bool operator==(std::nullptr_t) const
+    {
+        return is_null();
+    }
+
+    bool operator!=(std::nullptr_t) const
+    {
+        return !is_null();
+    }
+
+private:
+    FrozenBTSlot<T> const* nodes_;
+    Index index_;
+};
+
+/**
+ * @brief A read only BTree stored in a cache oblivious layout.
+ * The nodes are stored in a single array following the van Emde Boas
+ * layout: the tree is cut at the middle height, the top subtree is stored
+ * first and then each of the bottom subtrees, all of them recursively.
+ * So a root to leaf walk touches O(log_B(n)) cache lines for any cache
+ * line size B.
+ *
+ * Use freeze_btree() to create it.
+ */
+template <class T>
+class FrozenBTree
+{
+public:
+
+    typedef typename FrozenBTNode<T>::Ref Ref;
+    typedef typename FrozenBTNode<T>::Index Index;
+
+    /** @brief Create an empty tree.*/
+    FrozenBTree()
+    {}
+
+    /** @brief is the tree empty?.*/
+    bool is_empty () const
+    {
+        return nodes_.empty();
+    }
+
+    /** @brief Get the number of nodes.*/
+    size_t size() const
+    {
+        return nodes_.size();
+    }
+
+    /** @brief Get the root item.
+     * @pre not is_empty();
+     */
+    T const& item() const
+    {
+        assert(!is_empty());
+        return nodes_[0].item;
+    }
+
+    /** @brief Get the root node.*/
+    Ref root() const
+    {
+        return is_empty() ? Ref() : Ref(nodes_.data(), 0);
+    }
+
+    /** @brief Get the node array.*/
+    FrozenBTSlot<T> const* data() const
+    {
+        return nodes_.data();
+    }
+
+private:
+
+    template <class U>
+    friend FrozenBTree<U> freeze_btree(BTree<U> const& tree);
+
+    std::vector< FrozenBTSlot<T> > nodes_;
+};
+
+/** @brief Get the height (number of levels) of a subtree without recursion.*/
+template <class T>
+size_t
+btnode_levels(BTNode<T> const* node)
+{
+    size_t levels = 0;
+    std::vector< std::pair<BTNode<T> const*, size_t> > stack;
+    if (node != nullptr)
+        stack.push_back(std::make_pair(node, size_t(1)));
+    while (!stack.empty())
+    {
+        BTNode<T> const* n = stack.back().first;
+        size_t d = stack.back().second;
+        stack.pop_back();
+        levels = std::max(levels, d);
+        if (n->has_right())
+            stack.push_back(std::make_pair(n->right().get(), d+1));
+        if (n->has_left())
+            stack.push_back(std::make_pair(n->left().get(), d+1));
+    }
+    return levels;
+}
+
+/** @brief Append to order the nodes of the subtree of node, truncated to
+ * levels, following the van Emde Boas layout.
+ */
+template <class T>
+void
+veb_layout(BTNode<T> const* node, size_t levels, std::vector<BTNode<T> const*>& order)
+{
+    assert(node != nullptr && levels > 0);
+    if (levels == 1)
+    {
+        order.push_back(node);
+        return;
+    }
+
+    const size_t top_levels = levels / 2;
+    veb_layout(node, top_levels, order);
+
+    //The roots of the bottom subtrees are the nodes at depth top_levels,
+    //taken from left to right.
+    std::vector< std::pair<BTNode<T> const*, size_t> > stack;
+    stack.push_back(std::make_pair(node, size_t(0)));
+    while (!stack.empty())
+    {
+        BTNode<T> const* n = stack.back().first;
+        size_t d = stack.back().second;
+        stack.pop_back();
+        if (d == top_levels)
+            veb_layout(n, levels - top_levels, order);
+        else
+        {
+            if (n->has_right())
+                stack.push_back(std::make_pair(n->right().get(), d+1));
+            if (n->has_left())
+                stack.push_back(std::make_pair(n->left().get(), d+1));
+        }
+    }
+}
+
+/**
+ * @brief Freeze a tree into a read only tree with a cache oblivious layout.
+ * @pre the tree has less than 2^32-1 nodes.
+ */
+template <class T>
+FrozenBTree<T>
+freeze_btree(BTree<T> const& tree)
+{
+    typedef typename FrozenBTNode<T>::Index Index;
+    FrozenBTree<T> frozen;
+    if (tree.is_empty())
+        return frozen;
+
+    std::vector<BTNode<T> const*> order;
+    veb_layout(tree.root().get(), btnode_levels(tree.root().get()), order);
+    assert(order.size() < FrozenBTNode<T>::null_index);
+
+    std::unordered_map<BTNode<T> const*, Index> position;
+    position.reserve(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        position[order[i]] = static_cast<Index>(i);
+
+    frozen.nodes_.reserve(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        BTNode<T> const* n = order[i];
+        FrozenBTSlot<T> slot = {
+            n->item(),
+            n->has_left() ? position[n->left().get()] : FrozenBTNode<T>::null_index,
+            n->has_right() ? position[n->right().get()] : FrozenBTNode<T>::null_index
+        };
+        frozen.nodes_.push_back(slot);
+    }
+    return frozen;
+}
+
+/**  @brief Fold a frozen binary tree node.
+ * The output format is the same as fold_btnode().
+*/
+template<class T>
+std::ostream&
+fold_btnode (std::ostream& out, FrozenBTNode<T> const& node)
+{
+    out << "[";
+    if (node != nullptr)
+    {
+        out << node->item() << " : ";
+        fold_btnode<T>(out, node->left());
+        out << " : ";
+        fold_btnode<T>(out, node->right());
+    }
+    out << "]";
+    return out;
+}
+
+/**  @brief Fold a frozen binary tree. */
+template<class T>
+std::ostream&
+fold_btree ( std::ostream& out, FrozenBTree<T> const& tree)
+{
+    fold_btnode<T> (out, tree.root());
+    return out;
+}
+
+#endif
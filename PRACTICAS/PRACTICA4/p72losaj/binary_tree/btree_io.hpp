@@ -0,0 +1,433 @@
+#ifndef __ED_BTree_IO_HPP__
+#define __ED_BTree_IO_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "btree.hpp"
+
+/** @name Item text conversion.
+ * They are overloaded for the usual types to avoid the
+ * iostream machinery. Any other type uses operator<< and operator>>.
+ */
+/** @{*/
+
+template <class T>
+void
+append_btree_item(std::string& buffer, T const& item)
+{
+    std::ostringstream out;
+    out << item;
+    buffer += out.str();
+}
+
+inline void
+append_btree_item(std::string& buffer, int item)
+{
+    char text[16];
+    buffer.append(text, std::snprintf(text, sizeof(text), "%d", item));
+}
+
+inline void
+append_btree_item(std::string& buffer, long item)
+{
+    char text[32];
+    buffer.append(text, std::snprintf(text, sizeof(text), "%ld", item));
+}
+
+inline void
+append_btree_item(std::string& buffer, double item)
+{
+    //%g is the default format used by the output streams.
+    char text[32];
+    buffer.append(text, std::snprintf(text, sizeof(text), "%g", item));
+}
+
+inline void
+append_btree_item(std::string& buffer, float item)
+{
+    append_btree_item(buffer, static_cast<double>(item));
+}
+
+inline void
+append_btree_item(std::string& buffer, std::string const& item)
+{
+    buffer += item;
+}
+
+template <class T>
+bool
+parse_btree_item(std::string const& token, T& item)
+{
+    std::istringstream in(token);
+    in >> item;
+    return !in.fail();
+}
+
+/** @brief Was the whole token converted without overflow?*/
+inline bool
+btree_item_parsed(std::string const& token, char const* end)
+{
+    return end != token.c_str() && *end == '\0' && errno != ERANGE;
+}
+
+inline bool
+parse_btree_item(std::string const& token, int& item)
+{
+    char* end = nullptr;
+    errno = 0;
+    long v = std::strtol(token.c_str(), &end, 10);
+    if (!btree_item_parsed(token, end)
+        || v < std::numeric_limits<int>::min()
+        || v > std::numeric_limits<int>::max())
+        return false;
+    item = static_cast<int>(v);
+    return true;
+}
+
+inline bool
+parse_btree_item(std::string const& token, long& item)
+{
+    char* end = nullptr;
+    errno = 0;
+    item = std::strtol(token.c_str(), &end, 10);
+    return btree_item_parsed(token, end);
+}
+
+inline bool
+parse_btree_item(std::string const& token, double& item)
+{
+    char* end = nullptr;
+    errno = 0;
+    item = std::strtod(token.c_str(), &end);
+    return btree_item_parsed(token, end);
+}
+
+inline bool
+parse_btree_item(std::string const& token, float& item)
+{
+    char* end = nullptr;
+    errno = 0;
+    item = std::strtof(token.c_str(), &end);
+    return btree_item_parsed(token, end);
+}
+
+inline bool
+parse_btree_item(std::string const& token, std::string& item)
+{
+    item = token;
+    return true;
+}
+
+/** @}*/
+
+/**  @brief Fold a binary tree using a buffer.
+ * The output format is the same as fold_btree():
+ * [<item> : <left> : <right>] or [] if its a empty node.
+ * The tree is traversed without recursion and the text is written in
+ * blocks.
+*/
+template<class T>
+std::ostream&
+fold_btree_buffered (std::ostream& out, BTree<T> const& tree)
+{
+    static const size_t BLOCK_SIZE = 1 << 16;
+
+    //stage 0: the left subtree is pending, 1: the right one, 2: none.
+    struct Frame
+    {
+        BTNode<T> const* node;
+        int stage;
+    };
+    std::vector<Frame> stack;
+    std::string buffer;
+    buffer.reserve(BLOCK_SIZE + 256);
+
+    auto open = [&](BTNode<T> const* node)
+    {
+        if (node == nullptr)
+            buffer += "[]";
+        else
+        {
+            buffer += '[';
+            append_btree_item(buffer, node->item());
+            buffer += " : ";
+            Frame f = {node, 0};
+            stack.push_back(f);
+        }
+    };
+
+    open(tree.root().get());
+    while (!stack.empty() && out)
+    {
+        Frame& f = stack.back();
+        if (f.stage == 0)
+        {
+            f.stage = 1;
+            open(f.node->left().get());
+        }
+        else if (f.stage == 1)
+        {
+            f.stage = 2;
+            buffer += " : ";
+            open(f.node->right().get());
+        }
+        else
+        {
+            buffer += ']';
+            stack.pop_back();
+        }
+
+        if (buffer.size() >= BLOCK_SIZE)
+        {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    return out;
+}
+
+/** @brief Load a tree from a input stream using a buffer.
+ * It reads the format written by fold_btree() without recursion, taking
+ * the characters directly from the stream buffer.
+ * Only the characters of the tree are extracted from the stream.
+ * @warning runtime_error will throw if worng input format is found.
+ */
+template<class T>
+std::istream&
+unfold_btree_buffered (std::istream& in, BTree<T>& tree) noexcept(false)
+{
+    std::istream::sentry sentry(in, true);
+    if (!sentry)
+        throw std::runtime_error("Wrong input format.");
+    std::streambuf* buf = in.rdbuf();
+    typedef std::char_traits<char> Traits;
+
+    auto skip_spaces = [&]() -> int
+    {
+        int c = buf->sgetc();
+        while (c != Traits::eof() && std::isspace(c))
+            c = buf->snextc();
+        return c;
+    };
+    auto expect = [&](char sep)
+    {
+        if (skip_spaces() != sep)
+        {
+            in.setstate(std::ios::failbit);
+            throw std::runtime_error("Wrong input format.");
+        }
+        buf->sbumpc();
+    };
+
+    //stage 0: the left subtree is been read, 1: the right one.
+    struct Frame
+    {
+        typename BTNode<T>::Ref node;
+        int stage;
+    };
+    std::vector<Frame> stack;
+    typename BTNode<T>::Ref root;
+    typename BTNode<T>::Ref* slot = &root; //where the next node is linked.
+    std::string token;
+    T item;
+
+    while (true)
+    {
+        //Read a node: "[]" or "[item :" and then its left subtree.
+        expect('[');
+        if (skip_spaces() == ']')
+        {
+            buf->sbumpc();
+            slot->reset();
+        }
+        else
+        {
+            token.clear();
+            int c = buf->sgetc();
+            while (c != Traits::eof() && !std::isspace(c) && c != ':' && c != ']' && c != '[')
+            {
+                token += static_cast<char>(c);
+                c = buf->snextc();
+            }
+            if (!parse_btree_item(token, item))
+            {
+                in.setstate(std::ios::failbit);
+                throw std::runtime_error("Wrong input format.");
+            }
+            expect(':');
+            *slot = std::make_shared< BTNode<T> >(item);
+            Frame f = {*slot, 0};
+            stack.push_back(f);
+            slot = &stack.back().node->left();
+            continue;
+        }
+
+        //The node is completed. Go up closing the completed nodes.
+        while (!stack.empty() && stack.back().stage == 1)
+        {
+            expect(']');
+            stack.pop_back();
+        }
+        if (stack.empty())
+            break;
+        expect(':');
+        stack.back().stage = 1;
+        slot = &stack.back().node->right();
+    }
+
+    if (root.get() == nullptr)
+    {
+        if (!tree.is_empty())
+            tree.remove_root();
+    }
+    else
+        tree.set_root(root);
+    return in;
+}
+
+/** @brief Save a tree in a compact binary format.
+ * The format is, in native byte order:
+ * - the magic bytes "BTB1" and the number n of nodes as uint64_t.
+ * - a bitmap with 2 bits (has_left, has_right) for each node in prefix order.
+ * - the n items in prefix order.
+ * @pre T must be a trivially copyable type.
+ */
+template<class T>
+std::ostream&
+save_btree_binary (std::ostream& out, BTree<T> const& tree)
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "The binary format needs a trivially copyable type.");
+
+    std::vector<unsigned char> bitmap;
+    std::vector<T> items;
+    std::vector<BTNode<T> const*> stack;
+    if (!tree.is_empty())
+        stack.push_back(tree.root().get());
+    while (!stack.empty())
+    {
+        BTNode<T> const* node = stack.back();
+        stack.pop_back();
+
+        size_t bit = 2 * items.size();
+        if (bit % 8 == 0)
+            bitmap.push_back(0);
+        if (node->has_left())
+            bitmap.back() |= 1 << (bit % 8);
+        if (node->has_right())
+            bitmap.back() |= 2 << (bit % 8);
+        items.push_back(node->item());
+
+        if (node->has_right())
+            stack.push_back(node->right().get());
+        if (node->has_left())
+            stack.push_back(node->left().get());
+    }
+
+    std::uint64_t n = items.size();
+    out.write("BTB1", 4);
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    out.write(reinterpret_cast<const char*>(bitmap.data()), bitmap.size());
+    out.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+    return out;
+}
+
+/** @brief Read count values of a binary tree dump.
+ * The count comes from the input, so the values are read in bounded chunks
+ * and the vector only grows as far as the stream has data.
+ * @warning runtime_error will throw if the input is shorter.
+ */
+template<class V>
+void
+read_btree_binary_chunks (std::istream& in, std::vector<V>& values,
+                          std::uint64_t count) noexcept(false)
+{
+    static const std::uint64_t chunk = (std::uint64_t(1) << 16) / sizeof(V) + 1;
+    values.clear();
+    while (values.size() < count)
+    {
+        size_t begin = values.size();
+        size_t length = static_cast<size_t>(std::min<std::uint64_t>(chunk, count - begin));
+        values.resize(begin + length);
+        in.read(reinterpret_cast<char*>(values.data() + begin), length * sizeof(V));
+        if (!in)
+            throw std::runtime_error("Wrong input format.");
+    }
+}
+
+/** @brief Load a tree saved with save_btree_binary().
+ * @warning runtime_error will throw if worng input format is found.
+ */
+template<class T>
+std::istream&
+load_btree_binary (std::istream& in, BTree<T>& tree) noexcept(false)
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "The binary format needs a trivially copyable type.");
+
+    char magic[4];
+    std::uint64_t n = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    if (!in || std::memcmp(magic, "BTB1", 4) != 0)
+        throw std::runtime_error("Wrong input format.");
+
+    //n is not trusted: a size that can not be stored is rejected and the
+    //data is read by chunks, so a wrong n fails before a big allocation.
+    //The bitmap has ceil(2n/8) bytes (written so 2n can not overflow).
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        throw std::runtime_error("Wrong input format.");
+    std::vector<unsigned char> bitmap;
+    std::vector<T> items;
+    read_btree_binary_chunks(in, bitmap, n / 4 + (n % 4 != 0));
+    read_btree_binary_chunks(in, items, n);
+
+    typename BTNode<T>::Ref root;
+    std::vector<typename BTNode<T>::Ref*> slots; //links waiting for a node.
+    if (n > 0)
+        slots.push_back(&root);
+    for (std::uint64_t i = 0; i < n; ++i)
+    {
+        if (slots.empty())
+            throw std::runtime_error("Wrong input format.");
+        typename BTNode<T>::Ref* slot = slots.back();
+        slots.pop_back();
+
+        *slot = std::make_shared< BTNode<T> >(items[i]);
+        unsigned char bits = bitmap[(2 * i) / 8] >> ((2 * i) % 8);
+        if (bits & 2)
+            slots.push_back(&(*slot)->right());
+        if (bits & 1)
+            slots.push_back(&(*slot)->left());
+    }
+    if (!slots.empty())
+        throw std::runtime_error("Wrong input format.");
+
+    if (root.get() == nullptr)
+    {
+        if (!tree.is_empty())
+            tree.remove_root();
+    }
+    else
+        tree.set_root(root);
+    return in;
+}
+
+#endif
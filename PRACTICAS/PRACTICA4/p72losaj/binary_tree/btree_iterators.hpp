@@ -0,0 +1,412 @@
+#ifndef __ED_BTree_Iterators_HPP__
+#define __ED_BTree_Iterators_HPP__
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "btree.hpp"
+#include "btree_pool.hpp"
+
+/** @brief Get the node of a BTree<T> link as the iterators point to it.*/
+template <class T>
+BTNode<T> const*
+btree_iterator_node(std::shared_ptr< BTNode<T> > const& link)
+{
+    return link.get();
+}
+
+/** @brief Get the node of a PoolBTree<T> link as the iterators point to it.*/
+template <class T, class Tree>
+typename PoolBTree<T>::ConstRef
+btree_iterator_node(PoolBTNode<T, Tree> const& link)
+{
+    return link;
+}
+
+/**
+ * @brief Base of the BTree forward iterators.
+ * The iterators go over the items of the tree in a given order.
+ * Each iterator keeps its pending nodes in a vector used as a stack
+ * (or as a queue for the breadth first order), so an increment is
+ * amortized O(1) and does not allocate memory once the vector has grown.
+ *
+ * Two iterators are equal if they point to the same node. The past-the-end
+ * iterator does not point to any node.
+ *
+ * Node is the type used to point to a node: BTNode<T> const* for a
+ * BTree<T> or PoolBTree<T>::ConstRef for a PoolBTree<T>.
+ *
+ * @warning the tree must not be modified while it is being iterated.
+ */
+template <class T, class Node = BTNode<T> const*>
+class BTreeIteratorBase
+{
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T const* pointer;
+    typedef T const& reference;
+
+    /** @brief Get the current item.*/
+    reference operator*() const
+    {
+        assert(current_ != nullptr);
+        return current_->item();
+    }
+
+    /** @brief Get the current item.*/
+    pointer operator->() const
+    {
+        assert(current_ != nullptr);
+        return &current_->item();
+    }
+
+    /** @brief Get the current node.*/
+    Node node() const
+    {
+        return current_;
+    }
+
+    bool operator==(BTreeIteratorBase<T, Node> const& other) const
+    {
+        return current_ == other.current_;
+    }
+
+    bool operator!=(BTreeIteratorBase<T, Node> const& other) const
+    {
+        return current_ != other.current_;
+    }
+
+protected:
+
+    BTreeIteratorBase():
+        current_(nullptr)
+    {}
+
+    /** @brief Push the left most path starting from node.*/
+    void push_left_path(Node node)
+    {
+        while (node != nullptr)
+        {
+            pending_.push_back(node);
+            node = btree_iterator_node(node->left());
+        }
+    }
+
+    Node current_;
+    std::vector<Node> pending_;
+};
+
+/** @brief Prefix order (root, left, right) iterator.*/
+template <class T, class Node = BTNode<T> const*>
+class BTreePrefixIterator: public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create the past-the-end iterator.*/
+    BTreePrefixIterator()
+    {}
+
+    /** @brief Create an iterator to the first node of the subtree.*/
+    explicit BTreePrefixIterator(Node root)
+    {
+        this->current_ = root;
+    }
+
+    BTreePrefixIterator& operator++()
+    {
+        assert(this->current_ != nullptr);
+        Node n = this->current_;
+        if (n->has_right())
+            this->pending_.push_back(btree_iterator_node(n->right()));
+        if (n->has_left())
+            this->current_ = btree_iterator_node(n->left());
+        else if (!this->pending_.empty())
+        {
+            this->current_ = this->pending_.back();
+            this->pending_.pop_back();
+        }
+        else
+            this->current_ = nullptr;
+        return *this;
+    }
+
+    BTreePrefixIterator operator++(int)
+    {
+        BTreePrefixIterator old(*this);
+        ++(*this);
+        return old;
+    }
+};
+
+/** @brief Infix order (left, root, right) iterator.*/
+template <class T, class Node = BTNode<T> const*>
+class BTreeInfixIterator: public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create the past-the-end iterator.*/
+    BTreeInfixIterator()
+    {}
+
+    /** @brief Create an iterator to the first node of the subtree.*/
+    explicit BTreeInfixIterator(Node root)
+    {
+        this->push_left_path(root);
+        next();
+    }
+
+    BTreeInfixIterator& operator++()
+    {
+        assert(this->current_ != nullptr);
+        this->push_left_path(btree_iterator_node(this->current_->right()));
+        next();
+        return *this;
+    }
+
+    BTreeInfixIterator operator++(int)
+    {
+        BTreeInfixIterator old(*this);
+        ++(*this);
+        return old;
+    }
+
+private:
+
+    /** @brief The next node is at the top of the stack.*/
+    void next()
+    {
+        if (this->pending_.empty())
+            this->current_ = nullptr;
+        else
+        {
+            this->current_ = this->pending_.back();
+            this->pending_.pop_back();
+        }
+    }
+};
+
+/** @brief Postfix order (left, right, root) iterator.*/
+template <class T, class Node = BTNode<T> const*>
+class BTreePostfixIterator: public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create the past-the-end iterator.*/
+    BTreePostfixIterator()
+    {}
+
+    /** @brief Create an iterator to the first node of the subtree.*/
+    explicit BTreePostfixIterator(Node root)
+    {
+        push_first_leaf(root);
+        next();
+    }
+
+    BTreePostfixIterator& operator++()
+    {
+        assert(this->current_ != nullptr);
+        //If current is the left child of the top node, the right subtree
+        //of the top node must be processed before it.
+        if (!this->pending_.empty())
+        {
+            Node top = this->pending_.back();
+            if (btree_iterator_node(top->left()) == this->current_
+                && top->has_right())
+                push_first_leaf(btree_iterator_node(top->right()));
+        }
+        next();
+        return *this;
+    }
+
+    BTreePostfixIterator operator++(int)
+    {
+        BTreePostfixIterator old(*this);
+        ++(*this);
+        return old;
+    }
+
+private:
+
+    /** @brief Push the path to the first node in postfix order.*/
+    void push_first_leaf(Node node)
+    {
+        while (node != nullptr)
+        {
+            this->pending_.push_back(node);
+            node = btree_iterator_node(node->has_left() ? node->left()
+                                                         : node->right());
+        }
+    }
+
+    /** @brief The next node is at the top of the stack.*/
+    void next()
+    {
+        if (this->pending_.empty())
+            this->current_ = nullptr;
+        else
+        {
+            this->current_ = this->pending_.back();
+            this->pending_.pop_back();
+        }
+    }
+};
+
+/** @brief Breadth first (level) order iterator.*/
+template <class T, class Node = BTNode<T> const*>
+class BTreeBreadthFirstIterator: public BTreeIteratorBase<T, Node>
+{
+public:
+
+    /** @brief Create the past-the-end iterator.*/
+    BTreeBreadthFirstIterator():
+        head_(0)
+    {}
+
+    /** @brief Create an iterator to the first node of the subtree.*/
+    explicit BTreeBreadthFirstIterator(Node root):
+        head_(0)
+    {
+        this->current_ = root;
+    }
+
+    BTreeBreadthFirstIterator& operator++()
+    {
+        assert(this->current_ != nullptr);
+        Node n = this->current_;
+        if (n->has_left())
+            this->pending_.push_back(btree_iterator_node(n->left()));
+        if (n->has_right())
+            this->pending_.push_back(btree_iterator_node(n->right()));
+
+        if (head_ == this->pending_.size())
+            this->current_ = nullptr;
+        else
+        {
+            this->current_ = this->pending_[head_++];
+            //Reuse the consumed front of the queue.
+            if (head_ >= 32 && 2*head_ >= this->pending_.size())
+            {
+                this->pending_.erase(this->pending_.begin(),
+                                     this->pending_.begin() + head_);
+                head_ = 0;
+            }
+        }
+        return *this;
+    }
+
+    BTreeBreadthFirstIterator operator++(int)
+    {
+        BTreeBreadthFirstIterator old(*this);
+        ++(*this);
+        return old;
+    }
+
+private:
+    size_t head_; //first pending node of the queue.
+};
+
+/**
+ * @brief A range [begin, end) over the items of a tree.
+ * It allows to use range-for and the <algorithm> functions:
+ *    for (auto const& v: infix_range(tree)) ...
+ */
+template <class Iterator>
+class BTreeRange
+{
+public:
+    BTreeRange(Iterator const& b):
+        begin_(b)
+    {}
+
+    Iterator begin() const
+    {
+        return begin_;
+    }
+
+    Iterator end() const
+    {
+        return Iterator();
+    }
+
+private:
+    Iterator begin_;
+};
+
+/** @brief Get the items of a tree in prefix order.*/
+template <class T>
+BTreeRange< BTreePrefixIterator<T> >
+prefix_range(BTree<T> const& tree)
+{
+    return BTreeRange< BTreePrefixIterator<T> >(BTreePrefixIterator<T>(tree.root().get()));
+}
+
+/** @brief Get the items of a tree in infix order.*/
+template <class T>
+BTreeRange< BTreeInfixIterator<T> >
+infix_range(BTree<T> const& tree)
+{
+    return BTreeRange< BTreeInfixIterator<T> >(BTreeInfixIterator<T>(tree.root().get()));
+}
+
+/** @brief Get the items of a tree in postfix order.*/
+template <class T>
+BTreeRange< BTreePostfixIterator<T> >
+postfix_range(BTree<T> const& tree)
+{
+    return BTreeRange< BTreePostfixIterator<T> >(BTreePostfixIterator<T>(tree.root().get()));
+}
+
+/** @brief Get the items of a tree in breadth first order.*/
+template <class T>
+BTreeRange< BTreeBreadthFirstIterator<T> >
+breadth_first_range(BTree<T> const& tree)
+{
+    return BTreeRange< BTreeBreadthFirstIterator<T> >(BTreeBreadthFirstIterator<T>(tree.root().get()));
+}
+
+/** @name Ranges over a PoolBTree.*/
+/** @{*/
+
+/** @brief Get the items of a pooled tree in prefix order.*/
+template <class T>
+BTreeRange< BTreePrefixIterator<T, typename PoolBTree<T>::ConstRef> >
+prefix_range(PoolBTree<T> const& tree)
+{
+    typedef BTreePrefixIterator<T, typename PoolBTree<T>::ConstRef> Iterator;
+    return BTreeRange<Iterator>(Iterator(tree.root()));
+}
+
+/** @brief Get the items of a pooled tree in infix order.*/
+template <class T>
+BTreeRange< BTreeInfixIterator<T, typename PoolBTree<T>::ConstRef> >
+infix_range(PoolBTree<T> const& tree)
+{
+    typedef BTreeInfixIterator<T, typename PoolBTree<T>::ConstRef> Iterator;
+    return BTreeRange<Iterator>(Iterator(tree.root()));
+}
+
+/** @brief Get the items of a pooled tree in postfix order.*/
+template <class T>
+BTreeRange< BTreePostfixIterator<T, typename PoolBTree<T>::ConstRef> >
+postfix_range(PoolBTree<T> const& tree)
+{
+    typedef BTreePostfixIterator<T, typename PoolBTree<T>::ConstRef> Iterator;
+    return BTreeRange<Iterator>(Iterator(tree.root()));
+}
+
+/** @brief Get the items of a pooled tree in breadth first order.*/
+template <class T>
+BTreeRange< BTreeBreadthFirstIterator<T, typename PoolBTree<T>::ConstRef> >
+breadth_first_range(PoolBTree<T> const& tree)
+{
+    typedef BTreeBreadthFirstIterator<T, typename PoolBTree<T>::ConstRef> Iterator;
+    return BTreeRange<Iterator>(Iterator(tree.root()));
+}
+
+/** @}*/
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef __ED_BTree_Parallel_HPP__
+#define __ED_BTree_Parallel_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "btree.hpp"
+
+/** @brief Sequential postfix reduction of a subtree.
+ * The value of a node is combine(map(item), value(left), value(right)),
+ * where the value of an empty subtree is identity.
+ * The traversal is iterative so it does not depend on the tree height.
+ */
+template <class T, class R, class Map, class Combine>
+R
+reduce_btnode(BTNode<T> const* node, Map const& map, Combine const& combine,
+              R const& identity)
+{
+    if (node == nullptr)
+        return identity;
+
+    std::vector<BTNode<T> const*> stack;
+    std::vector<R> values; //values of the subtrees already reduced.
+    BTNode<T> const* last = nullptr;
+    while (node != nullptr || !stack.empty())
+    {
+        while (node != nullptr)
+        {
+            stack.push_back(node);
+            node = node->left().get();
+        }
+        BTNode<T> const* top = stack.back();
+        if (top->has_right() && top->right().get() != last)
+            node = top->right().get();
+        else
+        {
+            R r = top->has_right() ? values.back() : identity;
+            if (top->has_right())
+                values.pop_back();
+            R l = top->has_left() ? values.back() : identity;
+            if (top->has_left())
+                values.pop_back();
+            values.push_back(combine(map(top->item()), l, r));
+            last = top;
+            stack.pop_back();
+        }
+    }
+    assert(values.size() == 1);
+    return values.back();
+}
+
+/** @brief Default minimum number of nodes of a parallel task.
+ * Smaller trees and subtrees are processed by one thread, because the
+ * cost of a thread is higher than the cost of the traversal.
+ */
+static const size_t BTREE_PARALLEL_GRAIN = 4096;
+
+/** @brief Count the nodes of a subtree up to a limit.
+ * @return min(number of nodes, limit), visiting at most limit nodes.
+ */
+template <class T>
+size_t
+bounded_btnode_size(BTNode<T> const* node, size_t limit)
+{
+    std::vector<BTNode<T> const*> stack;
+    if (node != nullptr)
+        stack.push_back(node);
+    size_t count = 0;
+    while (!stack.empty() && count < limit)
+    {
+        node = stack.back();
+        stack.pop_back();
+        ++count;
+        if (node->has_right())
+            stack.push_back(node->right().get());
+        if (node->has_left())
+            stack.push_back(node->left().get());
+    }
+    return count;
+}
+
+/** @brief Split the top of a tree into subtrees (the parallel tasks).
+ * The nodes are split in breadth first order until there are about
+ * n_tasks subtrees. A subtree with less than 2*grain nodes is not split,
+ * so a task usually has about grain nodes or more.
+ * @arg[out] top are the split nodes in breadth first order.
+ * @arg[out] tasks are the subtrees to process in parallel.
+ */
+template <class T>
+void
+split_btree_tasks(BTNode<T> const* root, size_t n_tasks, size_t grain,
+                  std::vector<BTNode<T> const*>& top,
+                  std::vector<BTNode<T> const*>& tasks)
+{
+    std::vector<BTNode<T> const*> frontier(1, root);
+    size_t head = 0;
+    while (head < frontier.size())
+    {
+        BTNode<T> const* node = frontier[head++];
+        //Degenerate trees can not be split, so the top is also limited.
+        if (frontier.size() - head + tasks.size() + 1 < n_tasks &&
+            top.size() < 4 * n_tasks &&
+            (node->has_left() || node->has_right()) &&
+            bounded_btnode_size(node, 2 * grain) >= 2 * grain)
+        {
+            top.push_back(node);
+            if (node->has_left())
+                frontier.push_back(node->left().get());
+            if (node->has_right())
+                frontier.push_back(node->right().get());
+        }
+        else
+            tasks.push_back(node);
+    }
+}
+
+/** @brief Run task(i) for i in [0, n_tasks) with up to n_threads threads.
+ * The threads take the next pending task until all of them are done.
+ */
+template <class Task>
+void
+run_btree_tasks(size_t n_tasks, size_t n_threads, Task const& task)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < n_tasks; i = next++)
+            task(i);
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < std::min(n_threads, n_tasks); ++t)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+}
+
+/** @brief Parallel postfix reduction of a binary tree.
+ * The value of a node is combine(map(item), value(left), value(right)),
+ * where the value of an empty subtree is identity. For instance:
+ * - sum: map(x)=x, combine(v, l, r)=v+l+r, identity=0.
+ * - height: map(x)=0, combine(v, l, r)=1+max(l, r), identity=-1.
+ *
+ * The top of the tree is split (in breadth first order) into several
+ * subtrees per thread. The threads take the next pending subtree until all
+ * of them are reduced, so unbalanced subtrees are load balanced, and then
+ * the top nodes are combined. Subtrees with less than 2*grain nodes are not
+ * split, and a tree with less than grain nodes is reduced without threads.
+ *
+ * @arg n_threads is the number of threads to use (0 means the hardware
+ * concurrency).
+ * @warning map and combine are called concurrently.
+ */
+template <class T, class R, class Map, class Combine>
+R
+parallel_reduce(BTree<T> const& tree, Map const& map, Combine const& combine,
+                R const& identity, size_t n_threads=0,
+                size_t grain=BTREE_PARALLEL_GRAIN)
+{
+    //Number of subtrees per thread to allow load balancing.
+    static const size_t TASKS_PER_THREAD = 8;
+
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (tree.is_empty() || n_threads == 1 ||
+        bounded_btnode_size(tree.root().get(), grain) < grain)
+        return reduce_btnode<T, R>(tree.root().get(), map, combine, identity);
+
+    std::vector<BTNode<T> const*> top;
+    std::vector<BTNode<T> const*> tasks;
+    split_btree_tasks(tree.root().get(), n_threads * TASKS_PER_THREAD, grain,
+                      top, tasks);
+
+    //Reduce the tasks in parallel.
+    std::vector<R> results(tasks.size(), identity);
+    run_btree_tasks(tasks.size(), n_threads, [&](size_t i)
+    {
+        results[i] = reduce_btnode<T, R>(tasks[i], map, combine, identity);
+    });
+
+    //Combine the top nodes bottom-up (reverse breadth first order).
+    std::unordered_map<BTNode<T> const*, R> values;
+    for (size_t i = 0; i < tasks.size(); ++i)
+        values.insert(std::make_pair(tasks[i], results[i]));
+    for (size_t i = top.size(); i > 0; --i)
+    {
+        BTNode<T> const* node = top[i-1];
+        R l = node->has_left() ? values.at(node->left().get()) : identity;
+        R r = node->has_right() ? values.at(node->right().get()) : identity;
+        values.insert(std::make_pair(node, combine(map(node->item()), l, r)));
+    }
+    return values.at(tree.root().get());
+}
+
+/** @brief Sequential prefix (top-down) processing of a subtree.
+ * The value of a node is down(value(parent), item), where the value of
+ * the subtree's parent is parent_value, and visit(item, value) is called
+ * for each node in prefix order.
+ * The traversal is iterative so it does not depend on the tree height.
+ */
+template <class T, class R, class Down, class Visit>
+void
+prefix_btnode(BTNode<T> const* node, R const& parent_value, Down const& down,
+              Visit const& visit)
+{
+    if (node == nullptr)
+        return;
+
+    std::vector< std::pair<BTNode<T> const*, R> > stack;
+    stack.push_back(std::make_pair(node, parent_value));
+    while (!stack.empty())
+    {
+        node = stack.back().first;
+        R value = down(stack.back().second, node->item());
+        stack.pop_back();
+        visit(node->item(), value);
+        if (node->has_right())
+            stack.push_back(std::make_pair(node->right().get(), value));
+        if (node->has_left())
+            stack.push_back(std::make_pair(node->left().get(), value));
+    }
+}
+
+/** @brief Parallel prefix (top-down) processing of a binary tree.
+ * The value of a node is down(value(parent), item), where the value of
+ * the root's parent is root_value, and visit(item, value) is called once
+ * for each node. For instance, the depth of each node is given by
+ * down(d, x)=d+1 with root_value=-1.
+ *
+ * The top nodes are processed first and then their subtrees are processed
+ * in parallel as parallel_reduce() does, so the visit order is not defined.
+ *
+ * @arg n_threads is the number of threads to use (0 means the hardware
+ * concurrency).
+ * @warning down and visit are called concurrently.
+ */
+template <class T, class R, class Down, class Visit>
+void
+parallel_prefix(BTree<T> const& tree, Down const& down, R const& root_value,
+                Visit const& visit, size_t n_threads=0,
+                size_t grain=BTREE_PARALLEL_GRAIN)
+{
+    //Number of subtrees per thread to allow load balancing.
+    static const size_t TASKS_PER_THREAD = 8;
+
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (tree.is_empty() || n_threads == 1 ||
+        bounded_btnode_size(tree.root().get(), grain) < grain)
+    {
+        prefix_btnode<T, R>(tree.root().get(), root_value, down, visit);
+        return;
+    }
+
+    std::vector<BTNode<T> const*> top;
+    std::vector<BTNode<T> const*> tasks;
+    split_btree_tasks(tree.root().get(), n_threads * TASKS_PER_THREAD, grain,
+                      top, tasks);
+
+    //Process the top nodes top-down (breadth first order) keeping the
+    //value of the parent of each pending node.
+    std::unordered_map<BTNode<T> const*, R> parent_values;
+    parent_values.insert(std::make_pair(tree.root().get(), root_value));
+    for (size_t i = 0; i < top.size(); ++i)
+    {
+        BTNode<T> const* node = top[i];
+        R value = down(parent_values.at(node), node->item());
+        visit(node->item(), value);
+        if (node->has_left())
+            parent_values.insert(std::make_pair(node->left().get(), value));
+        if (node->has_right())
+            parent_values.insert(std::make_pair(node->right().get(), value));
+    }
+
+    run_btree_tasks(tasks.size(), n_threads, [&](size_t i)
+    {
+        prefix_btnode<T, R>(tasks[i], parent_values.at(tasks[i]), down, visit);
+    });
+}
+
+#endif
@@ -0,0 +1,518 @@
+#ifndef __ED_BTree_Pool_HPP__
+#define __ED_BTree_Pool_HPP__
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "btree.hpp"
+
+template <class T> class PoolBTree;
+
+/**
+ * @brief a PoolBTree's Node.
+ * The nodes live in a contiguous pool owned by the tree and are linked by
+ * 32 bits indexes, so a node reference is only a (tree, index) handle
+ * without a control block nor reference counting.
+ *
+ * The handle offers the same interface as BTNode<T> and operator-> returns
+ * the handle itself, so code written as node->left() works with both.
+ *
+ * With Tree = const PoolBTree<T> the handle is read only: the modifiers
+ * do not compile. A handle converts to its read only version.
+ */
+template <class T, class Tree = PoolBTree<T> >
+class PoolBTNode
+{
+public:
+
+    /** @brief Index of a node into the pool.*/
+    typedef std::uint32_t Index;
+
+    /** @brief Index used as null link.*/
+    static const Index null_index = std::numeric_limits<Index>::max();
+
+    /** @brief A reference to a node is the handle itself.*/
+    typedef PoolBTNode<T, Tree> Ref;
+
+    /** @name Life cicle.*/
+    /** @{*/
+
+    /** @brief Create a null reference.*/
+    PoolBTNode (std::nullptr_t = nullptr):
+        tree_(nullptr), index_(null_index)
+    {}
+
+    /** @brief Create a reference to the node index of a tree.*/
+    PoolBTNode (Tree* tree, Index index):
+        tree_(index == null_index ? nullptr : tree), index_(index)
+    {}
+
+    /** @brief Convert a handle to its read only version.*/
+    template <class Other>
+    PoolBTNode (PoolBTNode<T, Other> const& other):
+        tree_(other.tree_), index_(other.index_)
+    {}
+
+    /** @}*/
+
+    /** @name Observers.*/
+    /** @{*/
+
+    /** @brief Is it a null reference?*/
+    bool is_null() const
+    {
+        return index_ == null_index;
+    }
+
+    /** @brief Get the node index into the pool.*/
+    Index index() const
+    {
+        return index_;
+    }
+
+    /** @brief Get the data item.
+     * @pre not is_null()
+     */
+    const T& item() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).item;
+    }
+
+    /** @brief Has it a left child?*/
+    bool has_left() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).left != null_index;
+    }
+
+    /** @brief get the left child.*/
+    Ref left() const
+    {
+        assert(!is_null());
+        return Ref(tree_, tree_->slot(index_).left);
+    }
+
+    /** @brief Has it a right child? */
+    bool has_right() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).right != null_index;
+    }
+
+    /** @brief get the right child.*/
+    Ref right() const
+    {
+        assert(!is_null());
+        return Ref(tree_, tree_->slot(index_).right);
+    }
+
+    /** @brief Access to the node as a BTNode<T>::Ref does.*/
+    const Ref* operator->() const
+    {
+        return this;
+    }
+
+    /** @brief Access to the node as a BTNode<T>::Ref does.*/
+    Ref* operator->()
+    {
+        return this;
+    }
+
+    /** @brief Is this reference null?*/
+    explicit operator bool() const
+    {
+        return !is_null();
+    }
+
+    bool operator==(Ref const& other) const
+    {
+        return index_ == other.index_ && (is_null() || tree_ == other.tree_);
+    }
+
+    bool operator!=(Ref const& other) const
+    {
+        return !(*this == other);
+    }
+
+    /** @}*/
+
+    /** @name Modifiers.*/
+    /** @{*/
+
+    /** @brief Set the data item.*/
+    void set_item(const T& new_it)
+    {
+        assert(!is_null());
+        tree_->slot(index_).item = new_it;
+    }
+
+    /**
+     * @brief Set the left child.
+     * @pre new_child belongs to the same tree.
+     */
+    void set_left(Ref const& new_child)
+    {
+        assert(!is_null());
+        assert(new_child.is_null() || new_child.tree_ == tree_);
+        tree_->slot(index_).left = new_child.index_;
+    }
+
+    /**
+     * @brief Remove link to the left child.
+     * @post not has_left()
+     */
+    void remove_left()
+    {
+        assert(!is_null());
+        tree_->slot(index_).left = null_index;
+    }
+
+    /**
+     * @brief Set the right child.
+     * @pre new_child belongs to the same tree.
+     */
+    void set_right(Ref const& new_child)
+    {
+        assert(!is_null());
+        assert(new_child.is_null() || new_child.tree_ == tree_);
+        tree_->slot(index_).right = new_child.index_;
+    }
+
+    /**
+     * @brief Remove link to the right child.
+     * @post not has_right()
+     */
+    void remove_right()
+    {
+        assert(!is_null());
+        tree_->slot(index_).right = null_index;
+    }
+
+    /** @}*/
+
+protected:
+    template <class, class> friend class PoolBTNode;
+
+    Tree* tree_;
+    Index index_;
+};
+
+template <class T, class Tree>
+bool operator==(PoolBTNode<T, Tree> const& node, std::nullptr_t)
+{
+    return node.is_null();
+}
+
+template <class T, class Tree>
+bool operator!=(PoolBTNode<T, Tree> const& node, std::nullptr_t)
+{
+    return !node.is_null();
+}
+
+/**
+ * @brief ADT BTree with pooled storage.
+ * Models a BTree of T as BTree<T> does, but the nodes are stored in a
+ * contiguous vector and linked by 32 bits indexes.
+ *
+ * The nodes are created with new_node() and they are released all together
+ * when the tree is cleared or destroyed (unlinked nodes are not reused).
+ *
+ * The traversals (btree_utils.hpp), the iterators and fold_btree() are
+ * overloaded for a PoolBTree<T>.
+ * @note the io, parallel and frozen functions are written for BTree<T>.
+ */
+template<class T>
+class PoolBTree
+{
+  public:
+
+  /** @brief Define a reference to a node.*/
+  typedef typename PoolBTNode<T>::Ref Ref;
+
+  /** @brief Define a read only reference to a node.*/
+  typedef PoolBTNode<T, const PoolBTree<T> > ConstRef;
+
+  /** @brief Index of a node into the pool.*/
+  typedef typename PoolBTNode<T>::Index Index;
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+  /** @brief Create an empty BTree.
+   * @post is_empty()
+   */
+  PoolBTree ():
+      _root(PoolBTNode<T>::null_index)
+  {}
+
+  /** @brief Create Leaf BTree.
+   * @post not is_empty()
+   */
+  PoolBTree (const T& item):
+      _root(PoolBTNode<T>::null_index)
+  {
+      _root = new_node(item).index();
+  }
+
+  /** @brief Create a copy of a BTree<T> into the pool.*/
+  explicit PoolBTree (BTree<T> const& other):
+      _root(PoolBTNode<T>::null_index)
+  {
+      copy_btree(other);
+  }
+
+  /** @brief Destroy a BTree.**/
+  ~PoolBTree()
+  {}
+
+  /** @}*/
+
+  /** @name Observers*/
+
+  /** @{*/
+
+  /** @brief is the tree empty?.*/
+  bool is_empty () const
+  {
+      return _root == PoolBTNode<T>::null_index;
+  }
+
+  /** @brief Get the root item.
+   * @pre not is_empty();
+   */
+  T const& item() const
+  {
+      assert(!is_empty());
+      return _nodes[_root].item;
+  }
+
+  /** @brief Get the root node.*/
+  ConstRef root() const
+  {
+      return ConstRef(this, _root);
+  }
+
+  /** @brief Get the root node.*/
+  Ref root()
+  {
+      return Ref(this, _root);
+  }
+
+  /** @brief Get the number of nodes allocated in the pool.*/
+  size_t pool_size() const
+  {
+      return _nodes.size();
+  }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+
+  /** @{*/
+
+  /**
+   * @brief Create a new node into the pool.
+   * @pre left and right belong to this tree.
+   */
+  Ref new_node(T const& it=T(), Ref const& left=nullptr, Ref const& right=nullptr)
+  {
+      assert(_nodes.size() < PoolBTNode<T>::null_index);
+      _nodes.push_back(Slot(it, left.index(), right.index()));
+      return Ref(this, static_cast<Index>(_nodes.size()-1));
+  }
+
+  /** @brief Reserve room in the pool for n nodes.*/
+  void reserve(size_t n)
+  {
+      _nodes.reserve(n);
+  }
+
+  /**
+   * @brief set a new root node.
+   * @pre not new_root.is_null()
+   * @post not is_empty()
+   */
+  void set_root(Ref const& new_root)
+  {
+      assert(!new_root.is_null());
+      _root = new_root.index();
+      assert(!is_empty());
+  }
+
+  /**
+   * @brief Remove the link to the root node
+   * @post is_empty()
+   */
+  void remove_root()
+  {
+      _root = PoolBTNode<T>::null_index;
+      assert(is_empty());
+  }
+
+  /** @brief set the roor's item.
+   * @pre not is_empty()
+   */
+  void set_item(const T& new_it)
+  {
+      assert(!is_empty());
+      _nodes[_root].item = new_it;
+  }
+
+  /**
+   * @brief Release all the nodes.
+   * @post is_empty()
+   */
+  void clear()
+  {
+      _nodes.clear();
+      _root = PoolBTNode<T>::null_index;
+  }
+
+  /**
+   * @brief Replace this tree by a copy of a BTree<T>.
+   * The nodes are stored in prefix order.
+   */
+  void copy_btree(BTree<T> const& other)
+  {
+      clear();
+      if (other.is_empty())
+          return;
+
+      //Each pending node is paired with the parent's link to set
+      //(by index because the pool could be reallocated).
+      struct Pending
+      {
+          BTNode<T> const* node;
+          Index parent;
+          bool is_left;
+      };
+      std::vector<Pending> pending;
+      Pending first = {other.root().get(), PoolBTNode<T>::null_index, false};
+      pending.push_back(first);
+      while (!pending.empty())
+      {
+          Pending p = pending.back();
+          pending.pop_back();
+
+          Index i = new_node(p.node->item()).index();
+          if (p.parent == PoolBTNode<T>::null_index)
+              _root = i;
+          else if (p.is_left)
+              _nodes[p.parent].left = i;
+          else
+              _nodes[p.parent].right = i;
+
+          if (p.node->right() != nullptr)
+          {
+              Pending r = {p.node->right().get(), i, false};
+              pending.push_back(r);
+          }
+          if (p.node->left() != nullptr)
+          {
+              Pending l = {p.node->left().get(), i, true};
+              pending.push_back(l);
+          }
+      }
+  }
+
+  /** @}*/
+
+private:
+
+  /** @brief Copy constructor.
+   * @warning we don't want a copy constructor.
+   */
+  PoolBTree(const PoolBTree<T>& other);
+
+  template <class, class> friend class PoolBTNode;
+
+  /** @brief The node storage.*/
+  struct Slot
+  {
+      Slot(T const& it, Index l, Index r):
+          item(it), left(l), right(r)
+      {}
+
+      T item;
+      Index left;
+      Index right;
+  };
+
+  Slot& slot(Index i)
+  {
+      assert(i < _nodes.size());
+      return _nodes[i];
+  }
+
+  Slot const& slot(Index i) const
+  {
+      assert(i < _nodes.size());
+      return _nodes[i];
+  }
+
+protected:
+
+  std::vector<Slot> _nodes;
+  Index _root;
+
+};
+
+/**  @brief Fold a pooled binary tree node.
+ * The output format is the same as fold_btnode().
+ * It is iterative so it does not depend on the tree height.
+*/
+template<class T, class Tree>
+std::ostream&
+fold_btnode (std::ostream& out, PoolBTNode<T, Tree> const& node)
+{
+    //Each pending node is paired with the number of its subtrees folded.
+    struct Pending
+    {
+        PoolBTNode<T, Tree> node;
+        int folded;
+    };
+    std::vector<Pending> pending;
+    Pending first = {node, 0};
+    pending.push_back(first);
+    while (!pending.empty())
+    {
+        Pending& p = pending.back();
+        if (p.node == nullptr)
+        {
+            out << "[]";
+            pending.pop_back();
+        }
+        else if (p.folded == 2)
+        {
+            out << "]";
+            pending.pop_back();
+        }
+        else
+        {
+            if (p.folded == 0)
+                out << "[" << p.node->item() << " : ";
+            else
+                out << " : ";
+            Pending child = {p.folded == 0 ? p.node->left() : p.node->right(), 0};
+            ++p.folded;
+            pending.push_back(child); //p is not valid from here.
+        }
+    }
+    return out;
+}
+
+/**  @brief Fold a pooled binary tree. */
+template<class T>
+std::ostream&
+fold_btree ( std::ostream& out, PoolBTree<T> const& tree)
+{
+    fold_btnode<T> (out, tree.root());
+    return out;
+}
+
+#endif
@@ -6,15 +6,119 @@
 #include <memory>
 #include <iostream>
 #include <queue>
+#include <vector>
 
 #include "btree.hpp"
+#include "btree_pool.hpp"
 
 
+/** @brief How the traversals move through the links of a tree.
+ * A Link is what the traversal stacks keep to reach a node and
+ * node(link) is the reference given to Processor::apply().
+ *
+ * For a BTree<T> the links are pointers to the Ref that holds the node, so
+ * moving through the tree does not update any reference counter. For a
+ * PoolBTree<T> the links are the node handles.
+ */
+template <class Tree>
+struct BTreeLinks;
+
+template <class T>
+struct BTreeLinks< BTree<T> >
+{
+    typedef typename BTNode<T>::Ref Ref;
+    typedef Ref* Link;
+
+    static Link link(Ref& node)
+    {
+        return &node;
+    }
+
+    static Ref& node(Link l)
+    {
+        return *l;
+    }
+
+    static Link left(Link l)
+    {
+        return &(*l)->left();
+    }
+
+    static Link right(Link l)
+    {
+        return &(*l)->right();
+    }
+};
+
+template <class T>
+struct BTreeLinks< PoolBTree<T> >
+{
+    typedef typename PoolBTree<T>::Ref Ref;
+    typedef Ref Link;
+
+    static Link link(Ref& node)
+    {
+        return node;
+    }
+
+    static Ref& node(Link& l)
+    {
+        return l;
+    }
+
+    static Link left(Link const& l)
+    {
+        return l.left();
+    }
+
+    static Link right(Link const& l)
+    {
+        return l.right();
+    }
+};
+
+/** @brief Initial capacity of the traversal stacks.
+ * It is enough for balanced trees of any practical size, so
+ * in most cases the stack is allocated only once.
+ */
+static const size_t BTREE_STACK_RESERVE = 64;
+
+/** @brief Prefix processing of the subtree hold by a link.
+ * @see prefix_process()
+ */
+template <class Links, class Processor>
+bool
+prefix_process_links(typename Links::Ref& node, Processor& p)
+{
+    typedef typename Links::Link Link;
+
+    std::vector<Link> stack;
+    stack.reserve(BTREE_STACK_RESERVE);
+    stack.push_back(Links::link(node));
+    while (!stack.empty())
+    {
+        Link l = stack.back();
+        stack.pop_back();
+        typename Links::Ref& n = Links::node(l);
+
+        if (!p.apply(n))
+            return false;
+
+        if (n->has_right())
+            stack.push_back(Links::right(l));
+        if (n->has_left())
+            stack.push_back(Links::left(l));
+    }
+    return true;
+}
+
 /** @brief Prefix processing of a node
  * The template class Processor must have an apply interface:
  * bool Processor::apply(BTNode<T>::Ref& node).
  * returning true to continue the process or false to stop it.
  *
+ * The traversal is iterative so it does not depend on the tree height.
+ *
  * @arg[in] node is the node to be processed.
  * @arg[in] is the process to be apply to the node item.
  * @pre node.get()!=null
@@ -24,17 +128,21 @@ template <class T, class Processor>
 bool
 prefix_process(typename BTNode<T>::Ref& node, Processor& p)
 {
-    assert(node.get()!=nullptr);    
-
-//TODO
-
-    p.apply(node);
-
-    if( node->left() ) prefix_process<T, Processor>( node->left(), p);
-
-    if( node->right() ) prefix_process<T, Processor>( node->right(), p);
+    assert(node.get()!=nullptr);
+    return prefix_process_links< BTreeLinks< BTree<T> > >(node, p);
+}
 
-    return false;
+/** @brief Prefix processing of a pooled node.
+ * The Processor must have the apply interface
+ * bool Processor::apply(PoolBTree<T>::Ref& node).
+ * @pre node != nullptr
+ */
+template <class T, class Processor>
+bool
+prefix_process(PoolBTNode<T>& node, Processor& p)
+{
+    assert(node != nullptr);
+    return prefix_process_links< BTreeLinks< PoolBTree<T> > >(node, p);
 }
 
 /** @brief Prefix processing of a binary tree
@@ -54,11 +162,65 @@ prefix_process(BTree<T>& tree, Processor& p)
     return retVal;
 }
 
+/** @brief Prefix processing of a pooled binary tree.
+ * @return true if all nodes were processed.
+ */
+template <class T, class Processor>
+bool
+prefix_process(PoolBTree<T>& tree, Processor& p)
+{
+    bool retVal = true;
+    if (!tree.is_empty())
+    {
+        typename PoolBTree<T>::Ref root = tree.root();
+        retVal = prefix_process<T, Processor>(root, p);
+    }
+    return retVal;
+}
+
+/** @brief Infix processing of the subtree hold by a link.
+ * @see infix_process()
+ */
+template <class Links, class Processor>
+bool
+infix_process_links(typename Links::Ref& node, Processor& p)
+{
+    typedef typename Links::Link Link;
+
+    std::vector<Link> stack;
+    stack.reserve(BTREE_STACK_RESERVE);
+    Link n = Links::link(node);
+    bool more = true; //n is a node to go down from.
+    while (more || !stack.empty())
+    {
+        //Go down to the left most node.
+        while (more)
+        {
+            stack.push_back(n);
+            more = Links::node(n)->has_left();
+            if (more)
+                n = Links::left(n);
+        }
+        n = stack.back();
+        stack.pop_back();
+
+        if (!p.apply(Links::node(n)))
+            return false;
+
+        more = Links::node(n)->has_right();
+        if (more)
+            n = Links::right(n);
+    }
+    return true;
+}
+
 /** @brief Infix processing of a node
  * The template class Processor must have an apply interface:
  * bool Processor::apply(BTNode<T>::Ref& node).
  * returning true to continue the process or false to stop it.
  *
+ * The traversal is iterative so it does not depend on the tree height.
+ *
  * @arg[in] node is the node to be processed.
  * @arg[in] is the process to be apply to the node item.
  * @pre node.get()!=null
@@ -69,12 +231,20 @@ bool
 infix_process(typename BTNode<T>::Ref& node, Processor& p)
 {
     assert(node.get()!=nullptr);
-//TODO
+    return infix_process_links< BTreeLinks< BTree<T> > >(node, p);
+}
 
-    if( node->left() ) infix_process <T, Processor> (node->left(), p);
-    p.apply(node);
-    if( node->right() ) infix_process <T,Processor> (node->right(), p);
-    return false;
+/** @brief Infix processing of a pooled node.
+ * The Processor must have the apply interface
+ * bool Processor::apply(PoolBTree<T>::Ref& node).
+ * @pre node != nullptr
+ */
+template <class T, class Processor>
+bool
+infix_process(PoolBTNode<T>& node, Processor& p)
+{
+    assert(node != nullptr);
+    return infix_process_links< BTreeLinks< PoolBTree<T> > >(node, p);
 }
 
 /** @brief Infix processing of a binary tree
@@ -94,11 +264,169 @@ infix_process(BTree<T>& tree, Processor& p)
     return retVal;
 }
 
+/** @brief Infix processing of a pooled binary tree.
+ * @return true if all nodes were processed.
+ */
+template <class T, class Processor>
+bool
+infix_process(PoolBTree<T>& tree, Processor& p)
+{
+    bool retVal = true;
+    if (!tree.is_empty())
+    {
+        typename PoolBTree<T>::Ref root = tree.root();
+        retVal = infix_process<T, Processor>(root, p);
+    }
+    return retVal;
+}
+
+/** @brief Infix processing of a tree using O(1) extra space.
+ * @see infix_process_morris()
+ */
+template <class Links, class Processor>
+bool
+infix_process_morris_links(typename Links::Ref root, Processor& p)
+{
+    typedef typename Links::Ref Ref;
+    typedef typename Links::Link Link;
+
+    bool go_on = true;
+    std::exception_ptr error;
+    auto apply = [&](Ref& node)
+    {
+        if (!go_on)
+            return;
+        try
+        {
+            go_on = p.apply(node);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            go_on = false;
+        }
+    };
+
+    Ref current = root;
+    while (current != nullptr)
+    {
+        if (!current->has_left())
+        {
+            apply(current);
+            current = current->right();
+        }
+        else
+        {
+            //Find the in order predecessor of current.
+            Link pred = Links::left(Links::link(current));
+            while (Links::node(pred)->has_right()
+                   && Links::node(pred)->right() != current)
+                pred = Links::right(pred);
+
+            if (!Links::node(pred)->has_right())
+            {
+                //Thread it and go down to the left.
+                Links::node(pred)->set_right(current);
+                current = current->left();
+            }
+            else
+            {
+                //Come back from the left subtree. Remove the thread.
+                Links::node(pred)->remove_right();
+                apply(current);
+                current = current->right();
+            }
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
+    return go_on;
+}
+
+/** @brief Infix processing of a binary tree using O(1) extra space.
+ * It uses the Morris threading: the right link of the in order predecessor
+ * is temporally pointed to the node to come back from the left subtree.
+ *
+ * The template class Processor must have an apply interface:
+ * bool Processor::apply(BTNode<T>::Ref & node).
+ * returning true to continue the process or false to stop it.
+ *
+ * Unlike infix_process(), apply() gets a copy of the node reference, not
+ * the tree's link, and it can see the threads: the right link of the in
+ * order predecessor of each pending ancestor points back to that ancestor.
+ *
+ * When the process is stopped, the traversal does not stop at once: it
+ * goes on to the end without applying to remove the threads. When apply()
+ * throws, the threads are removed in the same way and the exception is
+ * rethrown, so the tree is left as it was.
+ *
+ * @warning the Processor must not change the tree links because they are
+ * threaded while the traversal is running.
+ * @return true if all nodes were processed.
+ */
+template <class T, class Processor>
+bool
+infix_process_morris(BTree<T>& tree, Processor& p)
+{
+    return infix_process_morris_links< BTreeLinks< BTree<T> > >(tree.root(), p);
+}
+
+/** @brief Infix processing of a pooled binary tree using O(1) extra space.
+ * @see infix_process_morris(BTree<T>&, Processor&)
+ */
+template <class T, class Processor>
+bool
+infix_process_morris(PoolBTree<T>& tree, Processor& p)
+{
+    return infix_process_morris_links< BTreeLinks< PoolBTree<T> > >(tree.root(), p);
+}
+
+/** @brief Postfix processing of the subtree hold by a link.
+ * @see postfix_process()
+ */
+template <class Links, class Processor>
+bool
+postfix_process_links(typename Links::Ref& node, Processor& p)
+{
+    typedef typename Links::Link Link;
+
+    std::vector<Link> stack;
+    stack.reserve(BTREE_STACK_RESERVE);
+    Link last = Link(); //link of the last node processed.
+    Link n = Links::link(node);
+    bool more = true; //n is a node to go down from.
+    while (more || !stack.empty())
+    {
+        //Go down to the left most node.
+        while (more)
+        {
+            stack.push_back(n);
+            more = Links::node(n)->has_left();
+            if (more)
+                n = Links::left(n);
+        }
+        Link top = stack.back();
+        more = Links::node(top)->has_right() && Links::right(top) != last;
+        if (more)
+            n = Links::right(top); //first process the right subtree.
+        else
+        {
+            last = top;
+            stack.pop_back();
+            if (!p.apply(Links::node(last)))
+                return false;
+        }
+    }
+    return true;
+}
+
 /** @brief Postfix processing of a node
  * The template class Processor must have an apply interface:
  * bool Processor::apply(BTNode<T>::Ref & node).
  * returning true to continue the process or false to stop it.
  *
+ * The traversal is iterative so it does not depend on the tree height.
+ *
  * @arg[in] node is the node to be processed.
  * @arg[in] is the process to be apply to the node item.
  * @pre node.get()!=null
@@ -109,12 +437,20 @@ bool
 postfix_process(typename BTNode<T>::Ref& node, Processor& p)
 {
     assert(node.get()!=nullptr);
-//TODO
+    return postfix_process_links< BTreeLinks< BTree<T> > >(node, p);
+}
 
-    if( node->left() ) postfix_process <T, Processor> (node->left(), p);
-    if( node->right() ) postfix_process <T, Processor> (node->right(), p);
-    p.apply(node);
-    return false;
+/** @brief Postfix processing of a pooled node.
+ * The Processor must have the apply interface
+ * bool Processor::apply(PoolBTree<T>::Ref& node).
+ * @pre node != nullptr
+ */
+template <class T, class Processor>
+bool
+postfix_process(PoolBTNode<T>& node, Processor& p)
+{
+    assert(node != nullptr);
+    return postfix_process_links< BTreeLinks< PoolBTree<T> > >(node, p);
 }
 
 /** @brief Postfix processing of a binary tree
@@ -134,44 +470,77 @@ postfix_process(BTree<T>& tree, Processor& p)
     return retVal;
 }
 
+/** @brief Postfix processing of a pooled binary tree.
+ * @return true if all nodes were processed.
+ */
+template <class T, class Processor>
+bool
+postfix_process(PoolBTree<T>& tree, Processor& p)
+{
+    bool retVal = true;
+    if (!tree.is_empty())
+    {
+        typename PoolBTree<T>::Ref root = tree.root();
+        retVal = postfix_process<T, Processor>(root, p);
+    }
+    return retVal;
+}
+
+/** @brief Bread-first processing of the subtree hold by a link.
+ * @see breadth_first_process()
+ */
+template <class Links, class Processor>
+bool
+breadth_first_process_links(typename Links::Ref& node, Processor& p)
+{
+    typedef typename Links::Link Link;
+
+    std::queue<Link> _cola;
+    _cola.push(Links::link(node));
+    while (!_cola.empty())
+    {
+        Link l = _cola.front();
+        _cola.pop();
+        typename Links::Ref& n = Links::node(l);
+
+        if (!p.apply(n))
+            return false;
+
+        if (n->has_left())
+            _cola.push(Links::left(l));
+        if (n->has_right())
+            _cola.push(Links::right(l));
+    }
+    return true;
+}
 
 /** @brief Bread-first processing of a btree.
  * The template class Processor must have an apply interface:
  * bool Processor::apply(BTNode<T>::Ref& node).
  * returning true to continue the process or false to stop it.
  *
- * Wise: should you need a queue?
+ * @return true if all nodes were processed.
 */
 template <class T, class Processor>
 bool
 breadth_first_process(BTree<T>& tree, Processor& p)
 {
-//TODO
-
-    std::queue<typename BTNode<T>::Ref> _cola;
-
-    _cola.push(tree.root());
-
-    BTree <T> arbol;
-
-    while( _cola.empty() == false)
-    {
-        
-        arbol.set_root( _cola.front() );
-
-        _cola.pop();
-
-        p.apply(arbol.root());
-
-        if( arbol.root()->left() ) _cola.push(arbol.root()->left() );
-
-        if( arbol.root()->right() ) _cola.push(arbol.root()->right() );
-
-        
-    }
-    
+    if (tree.is_empty())
+        return true;
+    return breadth_first_process_links< BTreeLinks< BTree<T> > >(tree.root(), p);
+}
 
-    return false;
+/** @brief Bread-first processing of a pooled btree.
+ * @return true if all nodes were processed.
+*/
+template <class T, class Processor>
+bool
+breadth_first_process(PoolBTree<T>& tree, Processor& p)
+{
+    if (tree.is_empty())
+        return true;
+    typename PoolBTree<T>::Ref root = tree.root();
+    return breadth_first_process_links< BTreeLinks< PoolBTree<T> > >(root, p);
 }
 
 
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "heap.hpp"
+#include "heapsort.hpp"
+#include "bench_utils.hpp"
+
+/** @brief Counters of the instrumented runs.*/
+static unsigned long long n_comparisons = 0;
+static unsigned long long n_copies = 0;
+static unsigned long long n_moves = 0;
+
+/** @brief A 64 bytes record with an int key.*/
+struct Record64
+{
+    Record64(int k=0): key(k)
+    {}
+
+    int key;
+    char payload[64 - sizeof(int)];
+};
+
+inline bool operator<=(Record64 const& a, Record64 const& b)
+{
+    return a.key <= b.key;
+}
+
+inline bool operator==(Record64 const& a, Record64 const& b)
+{
+    return a.key == b.key;
+}
+
+/** @brief An item that counts its copies and moves.*/
+template <class T>
+struct Counted
+{
+    Counted(int k=0): value(k)
+    {}
+
+    Counted(Counted const& other): value(other.value)
+    {
+        ++n_copies;
+    }
+
+    Counted(Counted&& other): value(std::move(other.value))
+    {
+        ++n_moves;
+    }
+
+    Counted& operator=(Counted const& other)
+    {
+        ++n_copies;
+        value = other.value;
+        return *this;
+    }
+
+    Counted& operator=(Counted&& other)
+    {
+        ++n_moves;
+        value = std::move(other.value);
+        return *this;
+    }
+
+    T value;
+};
+
+/** @brief A less_equal comparator that counts the comparisons.*/
+template <class T>
+struct CountingLessEqual
+{
+    bool operator()(Counted<T> const& a, Counted<T> const& b) const
+    {
+        ++n_comparisons;
+        return a.value <= b.value;
+    }
+};
+
+/** @brief Measures of a workload.*/
+struct Measure
+{
+    double ns_op;
+    double comparisons_op;
+    double copies_op;
+    double moves_op;
+};
+
+/** @name Workloads.
+ * Each one returns the number of operations done.
+ */
+/** @{*/
+
+/** @brief Build a heap from the values.*/
+template <class T, class Comp, size_t Arity>
+size_t
+run_heapify(std::vector<T>& values)
+{
+    Heap<T, Comp, Arity> heap(std::move(values));
+    sink() = heap.is_empty();
+    values = heap.release();
+    return values.size();
+}
+
+/** @brief Insert the values into an empty heap.*/
+template <class T, class Comp, size_t Arity>
+size_t
+run_insert(std::vector<T>& values)
+{
+    Heap<T, Comp, Arity> heap(values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+        heap.insert(values[i]);
+    sink() = heap.is_empty();
+    return values.size();
+}
+
+/** @brief Remove all the items of a heap built with the values.*/
+template <class T, class Comp, size_t Arity>
+size_t
+run_remove(std::vector<T>& values)
+{
+    Heap<T, Comp, Arity> heap(std::move(values));
+    const size_t n = heap.size();
+    while (!heap.is_empty())
+        heap.remove();
+    values = heap.release();
+    return n;
+}
+
+/** @brief Insert a value or remove the root (chosen by the value) on a
+ * heap with the first half of the values.
+ */
+template <class T, class Comp, size_t Arity>
+size_t
+run_mixed(std::vector<T>& values)
+{
+    const size_t half = values.size() / 2;
+    Heap<T, Comp, Arity> heap(values.size());
+    for (size_t i = 0; i < half; ++i)
+        heap.insert(values[i]);
+    unsigned bits = 0x9e3779b9u;
+    for (size_t i = half; i < values.size(); ++i)
+    {
+        bits = bits * 1664525u + 1013904223u;
+        if ((bits >> 31) || heap.is_empty())
+            heap.insert(values[i]);
+        else
+            heap.remove();
+    }
+    sink() = heap.is_empty();
+    return values.size() - half;
+}
+
+/** @brief Sort the values with heapsort().*/
+template <class T, class Comp, size_t Arity>
+size_t
+run_heapsort(std::vector<T>& values)
+{
+    heapsort<T, Comp>(values);
+    return values.size();
+}
+
+/** @}*/
+
+/** @brief Run a workload on a copy of the keys.
+ * The time is taken with T and std::less_equal, and the counters with
+ * Counted<T> and CountingLessEqual<T> when count is true.
+ */
+template <class T,
+          size_t (*Plain)(std::vector<T>&),
+          size_t (*Instrumented)(std::vector< Counted<T> >&)>
+Measure
+measure(std::vector<int> const& keys, bool count)
+{
+    Measure m = {0.0, 0.0, 0.0, 0.0};
+    {
+        std::vector<T> values(keys.begin(), keys.end());
+        size_t ops = 0;
+        double s = seconds([&]()
+        {
+            ops = Plain(values);
+        });
+        m.ns_op = ops ? 1e9 * s / ops : 0.0;
+    }
+    if (count)
+    {
+        std::vector< Counted<T> > values(keys.begin(), keys.end());
+        n_comparisons = 0;
+        n_copies = 0;
+        n_moves = 0;
+        size_t ops = Instrumented(values);
+        if (ops)
+        {
+            m.comparisons_op = static_cast<double>(n_comparisons) / ops;
+            m.copies_op = static_cast<double>(n_copies) / ops;
+            m.moves_op = static_cast<double>(n_moves) / ops;
+        }
+    }
+    return m;
+}
+
+static void
+write_row(const char* workload, const char* type, size_t arity,
+          const char* distribution, size_t n, Measure const& m)
+{
+    std::cout << workload << '\t' << type << '\t' << arity << '\t'
+              << distribution << '\t' << n << '\t' << m.ns_op << '\t'
+              << m.comparisons_op << '\t' << m.copies_op << '\t'
+              << m.moves_op << std::endl;
+}
+
+/** @brief Run all the workloads for an item type and arity.*/
+template <class T, size_t Arity>
+void
+bench_workloads(std::vector<int> const& keys, const char* type,
+                const char* distribution, bool count)
+{
+    typedef std::less_equal<T> Plain;
+    typedef CountingLessEqual<T> Instrumented;
+    typedef Counted<T> C;
+    const size_t n = keys.size();
+
+    write_row("heapify", type, Arity, distribution, n,
+              measure<T, run_heapify<T, Plain, Arity>,
+                      run_heapify<C, Instrumented, Arity>>(keys, count));
+    write_row("insert", type, Arity, distribution, n,
+              measure<T, run_insert<T, Plain, Arity>,
+                      run_insert<C, Instrumented, Arity>>(keys, count));
+    write_row("remove", type, Arity, distribution, n,
+              measure<T, run_remove<T, Plain, Arity>,
+                      run_remove<C, Instrumented, Arity>>(keys, count));
+    write_row("mixed", type, Arity, distribution, n,
+              measure<T, run_mixed<T, Plain, Arity>,
+                      run_mixed<C, Instrumented, Arity>>(keys, count));
+    //heapsort() always uses a binary heap.
+    if (Arity == 2)
+        write_row("heapsort", type, Arity, distribution, n,
+                  measure<T, run_heapsort<T, Plain, Arity>,
+                          run_heapsort<C, Instrumented, Arity>>(keys, count));
+}
+
+/** @brief Generate n keys with a distribution.
+ * @return false if the distribution is unknown.
+ */
+static bool
+make_keys(std::string const& distribution, size_t n, std::vector<int>& keys)
+{
+    std::mt19937_64 rng(1);
+    keys.resize(n);
+    if (distribution == "random")
+        for (size_t i = 0; i < n; ++i)
+            keys[i] = static_cast<int>(rng());
+    else if (distribution == "sorted")
+        for (size_t i = 0; i < n; ++i)
+            keys[i] = static_cast<int>(i);
+    else if (distribution == "reversed")
+        for (size_t i = 0; i < n; ++i)
+            keys[i] = static_cast<int>(n - i);
+    else if (distribution == "duplicates")
+        for (size_t i = 0; i < n; ++i)
+            keys[i] = static_cast<int>(rng() % 16);
+    else
+        return false;
+    return true;
+}
+
+/** @brief Benchmark the heap workloads.
+ * Usage: bench_heap [n[,n...]] [counts]
+ * The default n is 1e6 and it can be up to 1e8 (the 64 bytes items need
+ * 128*n bytes). Set counts to 0 to skip the instrumented runs.
+ * The output is a table with the ns, comparisons, copies and moves per operation
+ * for each workload, item type, arity and key distribution.
+ */
+int
+main(int argc, char* argv[])
+{
+    std::vector<size_t> sizes;
+    bool count = true;
+    bool ok = argc <= 3;
+    if (ok && argc > 1)
+        ok = parse_list(argv[1], sizes);
+    else
+        sizes.push_back(1000000);
+    if (ok && argc > 2)
+        count = std::atoi(argv[2]) != 0;
+    if (!ok)
+    {
+        std::cerr << "Usage: " << argv[0] << " [n[,n...]] [counts]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const char* distributions[] = {"random", "sorted", "reversed", "duplicates"};
+    std::cout << "workload\ttype\tarity\tdistribution\tn\tns_op\tcomparisons_op\tcopies_op\tmoves_op"
+              << std::endl;
+    std::vector<int> keys;
+    for (size_t s = 0; s < sizes.size(); ++s)
+        for (size_t d = 0; d < 4; ++d)
+        {
+            make_keys(distributions[d], sizes[s], keys);
+            bench_workloads<int, 2>(keys, "int", distributions[d], count);
+            bench_workloads<int, 4>(keys, "int", distributions[d], count);
+            bench_workloads<int, 8>(keys, "int", distributions[d], count);
+            bench_workloads<int, 16>(keys, "int", distributions[d], count);
+            bench_workloads<Record64, 2>(keys, "record64", distributions[d], count);
+            bench_workloads<Record64, 4>(keys, "record64", distributions[d], count);
+        }
+    return EXIT_SUCCESS;
+}
@@ -5,7 +5,25 @@
 #include <iostream>
 #include <functional>
 #include <memory>
+#include <type_traits>
 #include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/** @brief Size in bytes of a cache line.*/
+#define HEAP_CACHE_LINE 64
+
+/**
+ * @brief Check a heap invariant.
+ * The invariant checks are O(n), so they are only run when the macro
+ * __HEAP_DEBUG_CHECKS is defined (i.e. -D__HEAP_DEBUG_CHECKS).
+ */
+#ifdef __HEAP_DEBUG_CHECKS
+#define HEAP_CHECK(expr) assert(expr)
+#else
+#define HEAP_CHECK(expr)
+#endif
 
 /**
  * @brief Implement the Heap ADT.
@@ -29,8 +47,26 @@
  *
  * The type std::unique_ptr<> is strongly recommended to use for my_storage_ attribute.
  *
+ * The template parameter Arity is the number of children of each node
+ * (2 for a binary heap). A d-ary heap has log_d(n) levels, so a shift down
+ * does less memory accesses at the cost of more comparisons per level.
+ * The owned storage is placed so the children of a node, a contiguous group
+ * of Arity items, do not cross a cache line when Arity*sizeof(T) is a
+ * divisor or a multiple of the cache line size (i.e. Heap<int, Comp, 16>
+ * or Heap<double, Comp, 8>).
+ * The placement is best effort: the storage is a std::vector, only aligned
+ * to alignof(std::max_align_t), and the array can only be shifted by whole
+ * items. So the groups are always aligned when sizeof(T) divides
+ * alignof(std::max_align_t) (i.e. int or double items). For bigger items it
+ * depends on the address given by the allocator. An adopted vector and the
+ * storage of items without a default constructor are never shifted.
+ *
+ * The owned storage is a vector that doubles its capacity when an item is
+ * inserted into a full heap. Only the slots used by the items are
+ * constructed, so emplace() builds the new item in its slot. A vector can
+ * also be adopted, heapifying it in place, and given back with release().
  */
-template<class T, class Comp = std::less_equal<T> >
+template<class T, class Comp = std::less_equal<T>, size_t Arity = 2>
 class Heap
 {
   public:
@@ -46,43 +82,86 @@ class Heap
     Heap (int capacity=0)
     {
         //TODO
-        capacidad = capacity;
+        array = nullptr;
+        capacidad = 0;
         size_ = 0;
-        array = new T[capacidad];
+        reserve(capacity);
 
         //
-        assert(is_a_heap());
+        HEAP_CHECK(is_a_heap());
         assert(is_empty());
     }
 
     /**
      * @brief Create an Heap from a array of items.
-     * @waring The heap not is the responsable of the memory pointed by @arg data.
+     * @waring The heap not is the responsable of the memory pointed by @arg data,
+     * the items are copied.
      * @post is_full()
      */
     Heap (T* data, size_t size)
     {        
-        //TODO
-        capacidad = size;
+        array = nullptr;
+        capacidad = 0;
+        size_ = 0;
+        reserve(size);
+        storage_.insert(storage_.end(), data, data + size);
         size_ = size;
-        array = new T[capacidad];
 
-        for (int i = 0; i < size_; i++) {
-            array[i] = data[i];
-        }
+        heapify();
+        //
+        HEAP_CHECK(is_a_heap());
+        assert(is_full());
+    }
+
+    /**
+     * @brief Create an Heap adopting the storage of a vector.
+     * The items are heapified in place, without copying them.
+     * @post is_full()
+     */
+    explicit Heap (std::vector<T>&& values)
+    {
+        storage_ = std::move(values);
+        array = storage_.data();
+        capacidad = storage_.size();
+        size_ = capacidad;
 
         heapify();
         //
-        assert(is_a_heap());
+        HEAP_CHECK(is_a_heap());
         assert(is_full());
     }
 
-    /** @brief Destroy a Heap.**/
-    ~Heap()
+    /** @brief Move constructor.
+     * @post other.is_empty() and other.capacity()==0
+     */
+    Heap (Heap<T, Comp, Arity>&& other):
+        comp_(std::move(other.comp_)), storage_(std::move(other.storage_)),
+        array(other.array), capacidad(other.capacidad), size_(other.size_)
     {
-        delete array;
+        other.reset();
     }
 
+    /** @brief Move assign operator.
+     * @post other.is_empty() and other.capacity()==0
+     */
+    Heap<T, Comp, Arity>& operator=(Heap<T, Comp, Arity>&& other)
+    {
+        if (this != &other)
+        {
+            comp_ = std::move(other.comp_);
+            storage_ = std::move(other.storage_);
+            array = other.array;
+            capacidad = other.capacidad;
+            size_ = other.size_;
+            other.reset();
+        }
+        return *this;
+    }
+
+    /** @brief Destroy a Heap.**/
+    ~Heap()
+    {}
+
   /** @}*/
 
   /** @name Observers*/
@@ -140,28 +219,90 @@ class Heap
 
   /** @{*/
 
+    /**
+     * @brief Reserve room for n items.
+     * @post capacity() >= n
+     */
+    void reserve(size_t n)
+    {
+        if (n <= capacidad)
+            return;
+
+        const size_t group = Arity * sizeof(T);
+        const size_t align = group < HEAP_CACHE_LINE ? group : HEAP_CACHE_LINE;
+        const bool can_align = std::is_default_constructible<T>::value &&
+                Arity > 1 && align % sizeof(T) == 0 &&
+                (HEAP_CACHE_LINE % group == 0 || group % HEAP_CACHE_LINE == 0);
+        const size_t slack = can_align ? align / sizeof(T) : 0;
+
+        //The array is shifted inside the storage so the first child of the
+        //root (and so every group of children) starts at a group boundary.
+        //If no shift reaches the boundary the array is left unaligned.
+        //The slots before the array are the only ones constructed unused.
+        std::vector<T> new_storage;
+        new_storage.reserve(n + slack);
+        add_padding(new_storage, slack, std::is_default_constructible<T>());
+        size_t offset = 0;
+        while (offset < slack &&
+               reinterpret_cast<std::uintptr_t>(new_storage.data() + offset + 1) % align != 0)
+            ++offset;
+        if (offset == slack)
+            offset = 0;
+        new_storage.erase(new_storage.begin() + offset, new_storage.end());
+
+        //The removed items kept after the heap ones are moved too.
+        new_storage.insert(new_storage.end(), std::make_move_iterator(array),
+                           std::make_move_iterator(array + used()));
+        storage_.swap(new_storage);
+        array = storage_.data() + offset;
+        capacidad = n;
+    }
+
   /** @brief insert a new item.
-   * @pre not is_full()
+   * If the heap is full, its capacity is doubled.
+   * @post not is_empty()
    */
     void insert (T const& new_it)
     {
-        assert(! is_full());      
-        //TODO
-        array[size_]= new_it;
-        int i = size_;
+        emplace(new_it);
+    }
 
-        size_++;
-        
-        while (i > 0 && comp_(array[i], array[parent(i)])) {
-            int aux = array[i];
-            array[i] = array[parent(i)];
-            array[parent(i)] = aux;
+  /** @brief insert a new item moving it into the heap.
+   * If the heap is full, its capacity is doubled.
+   * @post not is_empty()
+   */
+    void insert (T&& new_it)
+    {
+        emplace(std::move(new_it));
+    }
 
-            i = parent(i);
+  /** @brief insert a new item built with the given arguments.
+   * The item is built in its slot of the storage and then shifted up.
+   * If the heap is full, its capacity is doubled.
+   * @post not is_empty()
+   */
+    template <class... Args>
+    void emplace (Args&&... args)
+    {
+        //The removed items kept after the heap ones are dropped, so the
+        //new item is built in a free slot.
+        storage_.erase(storage_.begin() + (array - storage_.data()) + size_,
+                       storage_.end());
+        if (is_full())
+        {
+            //The arguments could refer to a heap item, so the new item is
+            //built before the storage is moved.
+            T new_it(std::forward<Args>(args)...);
+            reserve(capacidad == 0 ? 1 : 2*capacidad);
+            storage_.push_back(std::move(new_it));
         }
+        else
+            storage_.emplace_back(std::forward<Args>(args)...);
+        size_++;
+        shit_up(size_-1);
 
         //
-        assert(is_a_heap());
+        HEAP_CHECK(is_a_heap());
     }
 
     /** @brief Remove the root item.
@@ -170,29 +311,100 @@ class Heap
     void remove()
     {
         assert(! is_empty());
-        //TODO
-        for (int i = 1; i < size_; i++) {
-            array[i-1] = array[i];
-        }
+        //The last item replaces the root and then it is shifted down.
         size_--;
+        if (size_ > 0)
+        {
+            std::swap(array[0], array[size_]);
+            shit_down(0);
+        }
 
-        heapify();
+        //
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /** @brief Remove the root item and return it.
+     * @pre not is_empty()
+     */
+    T pop()
+    {
+        assert(! is_empty());
+        T old_top = std::move(array[0]);
+        remove();
+        return old_top;
+    }
+
+    /**
+     * @brief Give back the storage as a vector.
+     * The heap items are at [0, size()). The items taken out with remove()
+     * (not with pop()) are kept after them, the first removed at the end,
+     * so removing all the items leaves the vector sorted. Nothing else is
+     * returned: the size of the vector is size() plus the removed items.
+     * @post is_empty() and capacity()==0
+     */
+    std::vector<T> release()
+    {
+        const size_t offset = array == nullptr ? 0 : array - storage_.data();
+        std::vector<T> values(std::move(storage_));
+        values.erase(values.begin(), values.begin() + offset);
+        reset();
+        return values;
+    }
+
+    /** @brief Replace the root item by a new one.
+     * It is the same as remove() followed by insert(new_it)
+     * but with only one shift down.
+     * @pre not is_empty()
+     */
+    void replace_top(T new_it)
+    {
+        assert(! is_empty());
+        array[0] = std::move(new_it);
+        shit_down(0);
 
         //
-        assert(is_a_heap());
+        HEAP_CHECK(is_a_heap());
     }
 
   /** @}*/
 private:
 
   /** @brief disable copy constructor.*/
-  Heap(Heap<T, Comp> const& other);
+  Heap(Heap<T, Comp, Arity> const& other);
 
   /** @brief disable assign operator.*/
-  Heap<T, Comp>& operator=(Heap<T, Comp> const& other);
+  Heap<T, Comp, Arity>& operator=(Heap<T, Comp, Arity> const& other);
 
 protected:
 
+    /** @brief Get the number of constructed slots from array.
+     * They are the heap items and the removed items kept after them.
+     */
+    size_t used() const
+    {
+        return array == nullptr ? 0 : storage_.data() + storage_.size() - array;
+    }
+
+    /** @brief Construct n padding slots at the end of the storage.*/
+    static void add_padding(std::vector<T>& storage, size_t n, std::true_type)
+    {
+        storage.resize(n);
+    }
+
+    /** @brief Items without a default constructor are not padded.*/
+    static void add_padding(std::vector<T>&, size_t, std::false_type)
+    {}
+
+    /** @brief Leave the heap empty without storage.*/
+    void reset()
+    {
+        storage_.clear();
+        storage_.shrink_to_fit();
+        array = nullptr;
+        capacidad = 0;
+        size_ = 0;
+    }
+
     /**
      * @brief get the parent of node i
      * @pre i>0
@@ -200,29 +412,23 @@ protected:
     int parent(int i) const
     {
         assert(i>0);
-        //TODO
-        int parent = i/2;
-        if (i % 2 == 0) { parent--; }
-
-        return parent;
+        return (i-1) / static_cast<int>(Arity);
     }
 
     /**
-     * @brief get the left child of node i.
+     * @brief get the first (left most) child of node i.
      */
     int left(int i) const
     {
-        //TODO
-        return (2*i)+1;
+        return static_cast<int>(Arity)*i + 1;
     }
 
     /**
-     * @brief get the right child of node i.
+     * @brief get the last (right most) child of node i.
      */
     int right(int i) const
     {
-        //TODO
-        return (2*i)+2;
+        return static_cast<int>(Arity)*i + static_cast<int>(Arity);
     }
 
     /**
@@ -230,93 +436,58 @@ protected:
      * @pre 0<=root && root < size()
      */
     bool is_a_heap(int root=0) const
-    {      
-        //TODO
-        bool izq = false, der = false;
-        // Lado izquierdo del subarbol
-        int l = left(root);
-        if( l >= size_) izq = true;
-        else if ( comp_(array[root], array[l])) izq = is_a_heap(l); // recursividad
-        else return false;
-        // lado derecho del subarbol
-        int r = right(root);
-        if( r >= size_) der = true;
-        else if ( comp_(array[root], array[r])) der = is_a_heap(r); // recursividad
-        else return false;
-
-        return izq && der;
-
+    {
+        //Every node of the subtree must be "lesser" than its children.
+        const int n_items = static_cast<int>(size_);
+        for (int first = root, last = root; first < n_items;
+             first = left(first), last = right(last))
+            for (int i = first; i <= last && i < n_items; ++i)
+                for (int c = left(i); c <= right(i) && c < n_items; ++c)
+                    if (!comp_(array[i], array[c]))
+                        return false;
+        return true;
     }
 
   /** @brief Shitup a node.*/
     void shit_up(int i)
     {
-        int p = parent(i);
-
-        //if _comp(item(i), item(p)), swap i with p and shift up p.
-        //TODO
-        if (comp_(array[i], array[p])) {
-            int aux = array[i];
-            array[i] = array[p];
-            array[p] = aux;
-
-            shit_up(p);
+        //while comp_(item(i), item(p)), swap i with p and go up.
+        while (i > 0 && comp_(array[i], array[parent(i)]))
+        {
+            std::swap(array[i], array[parent(i)]);
+            i = parent(i);
         }
-
     }
 
-    /** @brief shitdown a node. */
+    /** @brief shitdown a node.
+     * The item is kept apart and the children are moved up until
+     * its place is found, so each level costs a move instead of a swap.
+     */
     void shit_down(int i)
     {
-        int n = i; //n will have the node to swap with. by default is the root i.
-
-        int l = left(i); //the left child of i.
-        int r = right(i); //the right child of i.
-
-        //if l is a valid index and comp_(item(l), item(n) then now n is l
-        //TODO
-        if (l >= 0 && l < size_ && comp_(array[l], array[n])) {
-            T aux = array[n];
-            array[n] = array[l];
-            array[l] = aux;
-        }
-
-        //if r is a valid index and comp_(item(r), item(n) then now n i s r
-        //TODO
-        if (r >= 0 && r < size_ && comp_(array[r], array[n])) {
-            T aux = array[n];
-            array[n] = array[r];
-            array[r] = aux;
-        }
-        
-        //if i <> n then invariant is not meet, swap i with n and shift down n.
-        //TODO
-        if (i != n) {
-            int c = i;
+        const int n_items = static_cast<int>(size_);
+        T item = std::move(array[i]);
+        while (true)
+        {
+            int l = left(i); //the first child of i.
+            if (l >= n_items)
+                break;
+            int r = std::min(right(i), n_items-1); //the last child of i.
+
+            //n will have the child to compare with: the "lesser" one.
+            int n = l;
+            for (int c = l+1; c <= r; ++c)
+                if (comp_(array[c], array[n]))
+                    n = c;
+
+            //if comp_(item, item(n)) the invariant is met.
+            if (comp_(item, array[n]))
+                break;
+
+            array[i] = std::move(array[n]);
             i = n;
-            n = i;
-            shit_down(n);
-        }
-    }
-
-    void ordenar (int i) {
-        int n = i;
-        int l = left(i);
-        int r = right(i);
-
-        if (l < size_ && comp_(array[l], array[n]))
-            n = l;
-
-        if (r < size_ && comp_(array[r], array[n]))
-            n = r;
-
-        if (n != i) {
-            T aux = array[n];
-            array[n] = array[i];
-            array[i] = aux;
-
-            ordenar(n);
         }
+        array[i] = std::move(item);
     }
 
     /** @brief make the subtree starting in root to be a heap.*/
@@ -325,17 +496,18 @@ protected:
         //TODO
         //Remenber there are two ways to implement.
         //The best is to use shiftdowns from the second to last level (|size/2| ... 0)
-        for (int i = (size_ / 2)-1; i >= 0; i--) {
-            ordenar(i);
-        }
+        if (size_ > 1)
+            for (int i = parent(size_-1); i >= 0; i--) {
+                shit_down(i);
+            }
 
         //
-        assert(is_a_heap());
+        HEAP_CHECK(is_a_heap());
     }
 
     Comp comp_; //Functor to compare heap items. comp_(it1, it2)
 
-    //TODO
+    std::vector<T> storage_;
     T* array;
     size_t capacidad;
     size_t size_;
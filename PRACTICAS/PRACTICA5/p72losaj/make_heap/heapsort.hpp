@@ -1,6 +1,12 @@
 #ifndef HEAPSORT_HPP
 #define HEAPSORT_HPP
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include "heap.hpp"
 
@@ -13,20 +19,384 @@ template<class T, class Comp>
 void
 heapsort(std::vector<T>& values, Comp const& comparison_fn_t = Comp())
 {
-    //TODO (try an O(N Log(N)) implementation.
-    //May be you will need configure the proyect with
-    //    cmake -DCMAKE_BUILT_TYPE=Release ..
-    //to run the tests in time.
+    //The heap adopts the vector so the items are sorted in place:
+    //each removed root is kept just after the remaining heap items.
+    Heap<T, Comp> heap(std::move(values));
+    while (!heap.is_empty())
+        heap.remove();
+    values = heap.release();
+}
+
+/** @brief Ranges up to this size are sorted without partitioning.*/
+static const size_t HYBRID_SORT_SMALL = 16;
 
-    Heap<T, Comp> heap(values.data(), values.size());
+/** @brief Minimum number of items per thread to sort in parallel.*/
+static const size_t HYBRID_SORT_PARALLEL_MIN = 1 << 16;
+
+/**
+ * @brief The strict order used by heapsort().
+ * heapsort() leaves a before b when b goes up in the heap before a, so with
+ * std::less_equal the greater items go first.
+ * It is comp(b, a) and not comp(a, b), so it is strict (false for equal
+ * items) both with a non strict Comp as std::less_equal and with a strict
+ * one as std::less. The partition loops of introsort rely on it.
+ */
+template<class T, class Comp>
+struct HeapsortBefore
+{
+    HeapsortBefore(Comp const& c): comp(c)
+    {}
 
-    for(int i = heap.size()-1; i >= 0; i--)
+    bool operator()(T const& a, T const& b) const
     {
-    	
-    	values[i] = heap.top();
+        return comp(b, a) && !comp(a, b);
+    }
 
-    	heap.remove();
+    Comp comp;
+};
+
+/**
+ * @brief Value used to pad a block sorted with a sorting network.
+ * It is only enabled for arithmetic types with the std comparators, where
+ * the compare-exchanges of the network compile to selects without branches.
+ */
+template<class T, class Comp>
+struct SortNetworkPad
+{
+    static const bool enabled = false;
+};
+
+template<class T>
+struct SortNetworkPad<T, std::less_equal<T>>
+{
+    static const bool enabled = std::is_arithmetic<T>::value;
+
+    //greater to lesser order, so the padding is the lowest value.
+    static T value()
+    {
+        return std::numeric_limits<T>::has_infinity ?
+                    -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+};
+
+template<class T>
+struct SortNetworkPad<T, std::greater_equal<T>>
+{
+    static const bool enabled = std::is_arithmetic<T>::value;
+
+    //less to greater order, so the padding is the greatest value.
+    static T value()
+    {
+        return std::numeric_limits<T>::has_infinity ?
+                    std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
     }
+};
+
+/** @brief Sort a range with heapsort().*/
+template<class T, class Comp>
+void
+heapsort_range(T* first, T* last, Comp const& comp)
+{
+    std::vector<T> values(std::make_move_iterator(first), std::make_move_iterator(last));
+    heapsort<T, Comp>(values, comp);
+    std::move(values.begin(), values.end(), first);
+}
+
+/** @brief Sort a small range by insertion.*/
+template<class T, class Before>
+void
+insertion_sort_range(T* first, T* last, Before const& before)
+{
+    for (T* i = first + 1; i < last; ++i)
+    {
+        T item = std::move(*i);
+        T* j = i;
+        for (; j > first && before(item, *(j-1)); --j)
+            *j = std::move(*(j-1));
+        *j = std::move(item);
+    }
+}
+
+/** @brief A compare-exchange of a sorting network.*/
+struct SortNetworkPair
+{
+    unsigned char first;
+    unsigned char second;
+};
+
+/** @brief Number of compare-exchanges of the sorting network.*/
+static const size_t SORT_NETWORK_PAIRS = 63;
+
+/**
+ * @brief The compare-exchanges of a Batcher odd-even merge network
+ * for HYBRID_SORT_SMALL (16) items.
+ */
+static const SortNetworkPair SORT_NETWORK[SORT_NETWORK_PAIRS] =
+{
+    {0, 1}, {2, 3}, {4, 5}, {6, 7}, {8, 9}, {10, 11}, {12, 13}, {14, 15},
+    {0, 2}, {1, 3}, {4, 6}, {5, 7}, {8, 10}, {9, 11}, {12, 14}, {13, 15},
+    {1, 2}, {5, 6}, {9, 10}, {13, 14}, {0, 4}, {1, 5}, {2, 6}, {3, 7},
+    {8, 12}, {9, 13}, {10, 14}, {11, 15}, {2, 4}, {3, 5}, {10, 12}, {11, 13},
+    {1, 2}, {3, 4}, {5, 6}, {9, 10}, {11, 12}, {13, 14}, {0, 8}, {1, 9},
+    {2, 10}, {3, 11}, {4, 12}, {5, 13}, {6, 14}, {7, 15}, {4, 8}, {5, 9},
+    {6, 10}, {7, 11}, {2, 4}, {3, 5}, {6, 8}, {7, 9}, {10, 12}, {11, 13},
+    {1, 2}, {3, 4}, {5, 6}, {7, 8}, {9, 10}, {11, 12}, {13, 14}
+};
+
+/**
+ * @brief Sort a small range with a sorting network.
+ * The range is padded up to HYBRID_SORT_SMALL items and sorted with the
+ * fixed sequence of compare-exchanges of SORT_NETWORK, known at compile
+ * time. Each compare-exchange is a select without branches, so there are
+ * no mispredictions as in an insertion sort, but all of them are done
+ * whatever the size of the range is.
+ */
+template<class T, class Before>
+void
+network_sort_range(T* first, T* last, Before const& before, T const& pad)
+{
+    static_assert(HYBRID_SORT_SMALL == 16, "SORT_NETWORK sorts 16 items.");
+
+    T block[HYBRID_SORT_SMALL];
+    const size_t size = last - first;
+    std::copy(first, last, block);
+    std::fill(block + size, block + HYBRID_SORT_SMALL, pad);
+
+    for (size_t p = 0; p < SORT_NETWORK_PAIRS; ++p)
+    {
+        const T a = block[SORT_NETWORK[p].first];
+        const T b = block[SORT_NETWORK[p].second];
+        const bool s = before(b, a);
+        block[SORT_NETWORK[p].first] = s ? b : a;
+        block[SORT_NETWORK[p].second] = s ? a : b;
+    }
+
+    std::copy(block, block + size, first);
+}
+
+template<class T, class Comp>
+void
+small_sort_range(T* first, T* last, Comp const& comp, std::true_type)
+{
+    network_sort_range(first, last, HeapsortBefore<T, Comp>(comp),
+                       SortNetworkPad<T, Comp>::value());
+}
+
+template<class T, class Comp>
+void
+small_sort_range(T* first, T* last, Comp const& comp, std::false_type)
+{
+    insertion_sort_range(first, last, HeapsortBefore<T, Comp>(comp));
+}
+
+/**
+ * @brief Sort a range with introsort.
+ * It is a quicksort with a median of three pivot. When the recursion is
+ * deeper than depth, the range is sorted with heapsort() so the worst case
+ * is O(n log n).
+ */
+template<class T, class Comp>
+void
+introsort_range(T* first, T* last, size_t depth, Comp const& comp)
+{
+    HeapsortBefore<T, Comp> before(comp);
+    while (static_cast<size_t>(last - first) > HYBRID_SORT_SMALL)
+    {
+        if (depth == 0)
+        {
+            heapsort_range(first, last, comp);
+            return;
+        }
+        --depth;
+
+        //Median of three. The pivot is moved to first and the other
+        //two items act as sentinels for the partition loops.
+        T* a = first + 1;
+        T* b = first + (last - first) / 2;
+        T* c = last - 1;
+        if (before(*b, *a))
+            std::swap(*a, *b);
+        if (before(*c, *b))
+            std::swap(*b, *c);
+        if (before(*b, *a))
+            std::swap(*a, *b);
+        std::swap(*first, *b);
+
+        T* i = first;
+        T* j = last;
+        while (true)
+        {
+            do ++i; while (before(*i, *first));
+            do --j; while (before(*first, *j));
+            if (i >= j)
+                break;
+            std::swap(*i, *j);
+        }
+        std::swap(*first, *j);
+
+        //Recurse into the smaller side and loop on the larger one.
+        if (j - first < last - (j+1))
+        {
+            introsort_range(first, j, depth, comp);
+            first = j + 1;
+        }
+        else
+        {
+            introsort_range(j + 1, last, depth, comp);
+            last = j;
+        }
+    }
+    if (last - first > 1)
+        small_sort_range(first, last, comp,
+                         std::integral_constant<bool, SortNetworkPad<T, Comp>::enabled>());
+}
+
+/** @brief Sort a range with introsort.*/
+template<class T, class Comp>
+void
+introsort_range(T* first, T* last, Comp const& comp)
+{
+    size_t depth = 0;
+    for (size_t n = last - first; n > 1; n /= 2)
+        depth += 2;
+    introsort_range(first, last, depth, comp);
+}
+
+/** @brief A sorted run being merged.*/
+template<class T>
+struct SortRunCursor
+{
+    T* pos;
+    T* end;
+};
+
+/** @brief Heap comparator for the runs: the run with the first item.*/
+template<class T, class Comp>
+struct SortRunComp
+{
+    //a goes first when b is not before a.
+    bool operator()(SortRunCursor<T> const& a, SortRunCursor<T> const& b) const
+    {
+        return comp(*b.pos, *a.pos);
+    }
+
+    Comp comp;
+};
+
+/**
+ * @brief Sort in parallel using a multiway merge.
+ * The values are split into one run per thread and each run is sorted with
+ * introsort. Then the key space is split by splitters taken from a sample
+ * of the runs, so each thread merges its own part of all the runs with a
+ * Heap of runs and writes it to its own part of the output.
+ */
+template<class T, class Comp>
+void
+parallel_sort(std::vector<T>& values, Comp const& comp, size_t n_threads)
+{
+    //Sample items per thread to choose the splitters.
+    static const size_t SAMPLES_PER_THREAD = 32;
+
+    HeapsortBefore<T, Comp> before(comp);
+    const size_t n = values.size();
+    T* data = values.data();
+
+    auto run_in_parallel = [&](std::function<void(size_t)> const& task)
+    {
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < n_threads; ++t)
+            threads.push_back(std::thread(task, t));
+        task(0);
+        for (size_t t = 0; t < threads.size(); ++t)
+            threads[t].join();
+    };
+
+    //Sort the runs.
+    std::vector<size_t> bounds(n_threads + 1);
+    for (size_t t = 0; t <= n_threads; ++t)
+        bounds[t] = n * t / n_threads;
+    run_in_parallel([&](size_t t)
+    {
+        introsort_range(data + bounds[t], data + bounds[t+1], comp);
+    });
+
+    //Choose the splitters from a sample of the runs.
+    std::vector<T> sample;
+    for (size_t r = 0; r < n_threads; ++r)
+        for (size_t s = 0; s < SAMPLES_PER_THREAD; ++s)
+            sample.push_back(data[bounds[r] + (bounds[r+1]-bounds[r]) * s / SAMPLES_PER_THREAD]);
+    introsort_range(sample.data(), sample.data() + sample.size(), comp);
+
+    //cut[t][r] is where the part t of the run r begins.
+    std::vector< std::vector<T*> > cut(n_threads + 1, std::vector<T*>(n_threads));
+    for (size_t r = 0; r < n_threads; ++r)
+    {
+        cut[0][r] = data + bounds[r];
+        cut[n_threads][r] = data + bounds[r+1];
+        for (size_t t = 1; t < n_threads; ++t)
+            cut[t][r] = std::lower_bound(cut[t-1][r], data + bounds[r+1],
+                                         sample[t * SAMPLES_PER_THREAD], before);
+    }
+
+    //Merge each part into the output.
+    std::vector<size_t> offset(n_threads + 1, 0);
+    for (size_t t = 0; t < n_threads; ++t)
+    {
+        offset[t+1] = offset[t];
+        for (size_t r = 0; r < n_threads; ++r)
+            offset[t+1] += cut[t+1][r] - cut[t][r];
+    }
+    std::vector<T> output(n);
+    run_in_parallel([&](size_t t)
+    {
+        Heap<SortRunCursor<T>, SortRunComp<T, Comp>> runs(n_threads);
+        for (size_t r = 0; r < n_threads; ++r)
+            if (cut[t][r] != cut[t+1][r])
+            {
+                SortRunCursor<T> run = {cut[t][r], cut[t+1][r]};
+                runs.insert(run);
+            }
+        T* out = output.data() + offset[t];
+        while (!runs.is_empty())
+        {
+            SortRunCursor<T> run = runs.top();
+            *out++ = std::move(*run.pos++);
+            if (run.pos != run.end)
+                runs.replace_top(run);
+            else
+                runs.remove();
+        }
+    });
+    values.swap(output);
+}
+
+/**
+ * @brief Sort an array of values with a hybrid algorithm.
+ * The order is the same as heapsort() with the same Comp, so a call to
+ * heapsort<T, Comp>(values) can be replaced by hybrid_sort<T, Comp>(values).
+ *
+ * Small inputs are sorted with introsort, where heapsort() is the fallback
+ * that keeps the worst case in O(n log n), and the small ranges are sorted
+ * with sorting networks for arithmetic types (when Comp is std::less_equal
+ * or std::greater_equal) or by insertion otherwise.
+ * Large inputs are sorted in parallel with a multiway merge.
+ *
+ * @arg n_threads is the number of threads to use (0 means the hardware
+ * concurrency).
+ * @warning the comparator is called concurrently.
+ */
+template<class T, class Comp>
+void
+hybrid_sort(std::vector<T>& values, Comp const& comp = Comp(), size_t n_threads=0)
+{
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min(n_threads, values.size() / HYBRID_SORT_PARALLEL_MIN);
+
+    if (n_threads > 1)
+        parallel_sort(values, comp, n_threads);
+    else if (values.size() > 1)
+        introsort_range(values.data(), values.data() + values.size(), comp);
 }
 
 #endif // HEAPSORT_HPP
@@ -0,0 +1,319 @@
+#ifndef __ED_IndexedHeap_HPP__
+#define __ED_IndexedHeap_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "heap.hpp"
+
+/**
+ * @brief Implement an addressable (indexed) Heap.
+ * Each item is a key identified by a handle in [0, n), i.e. the label of a
+ * graph vertex. A position map from handles to heap slots allows to update
+ * or erase the key of any handle in O(log n), so algorithms like Dijkstra,
+ * Prim or A* keep at most one entry per vertex in the queue.
+ *
+ * The parameter template Comp must implement the interface:
+ *          bool operator()(T const& a, T const& b)
+ * as in Heap<T, Comp, Arity>, i.e. std::less_equal<T> for a min-heap. A
+ * strict comparator (std::less<T>) also works: equivalent keys are never
+ * moved one over the other.
+ *
+ * The heap slots only store handles, the keys are stored by handle, so
+ * reordering the heap never moves a key.
+ */
+template<class T, class Comp = std::less_equal<T>, size_t Arity = 2>
+class IndexedHeap
+{
+  public:
+
+    /** @brief Identifier of an item.*/
+    typedef size_t Handle;
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+    /**
+     * @brief Create an empty heap for the handles [0, n_handles).
+     * @post is_empty()
+     */
+    IndexedHeap (size_t n_handles=0):
+        keys_(n_handles), position_(n_handles, NONE)
+    {
+        assert(is_empty());
+    }
+
+  /** @}*/
+
+  /** @name Observers*/
+  /** @{*/
+
+    /** @brief is the heap empty?.*/
+    bool is_empty () const
+    {
+        return heap_.empty();
+    }
+
+    /** @brief Get the heap size. */
+    size_t size() const
+    {
+        return heap_.size();
+    }
+
+    /** @brief Is the handle into the heap?*/
+    bool has(Handle h) const
+    {
+        return h < position_.size() && position_[h] != NONE;
+    }
+
+    /** @brief Get the key of a handle.
+     * @pre has(h)
+     */
+    T const& key(Handle h) const
+    {
+        assert(has(h));
+        return keys_[h];
+    }
+
+    /** @brief Get the root key.
+     * @pre not is_empty();
+     */
+    T const& top() const
+    {
+        assert(! is_empty());
+        return keys_[heap_[0]];
+    }
+
+    /** @brief Get the handle of the root key.
+     * @pre not is_empty();
+     */
+    Handle top_handle() const
+    {
+        assert(! is_empty());
+        return heap_[0];
+    }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+  /** @{*/
+
+    /**
+     * @brief insert a new key for a handle.
+     * The handle space grows if h is out of it.
+     * @pre not has(h)
+     * @post has(h) and key(h)==k
+     */
+    void insert (Handle h, T const& k)
+    {
+        assert(! has(h));
+        if (h >= position_.size())
+        {
+            keys_.resize(h+1);
+            position_.resize(h+1, NONE);
+        }
+        keys_[h] = k;
+        position_[h] = heap_.size();
+        heap_.push_back(h);
+        shift_up(heap_.size()-1);
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /** @brief Remove the root key.
+     * @pre not is_empty()
+     */
+    void remove()
+    {
+        assert(! is_empty());
+        erase(heap_[0]);
+    }
+
+    /** @brief Remove the root key and get its handle.
+     * @pre not is_empty()
+     */
+    Handle pop()
+    {
+        Handle h = top_handle();
+        remove();
+        return h;
+    }
+
+    /**
+     * @brief Remove the key of a handle.
+     * @pre has(h)
+     * @post not has(h)
+     */
+    void erase(Handle h)
+    {
+        assert(has(h));
+        const size_t i = position_[h];
+        const size_t last = heap_.size()-1;
+        if (i != last)
+        {
+            swap_slots(i, last);
+            heap_.pop_back();
+            position_[h] = NONE;
+            //The moved key could go up or down.
+            const Handle moved = heap_[i];
+            shift_up(i);
+            shift_down(position_[moved]);
+        }
+        else
+        {
+            heap_.pop_back();
+            position_[h] = NONE;
+        }
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /**
+     * @brief Set a key that goes up (i.e. lower for a min-heap).
+     * @pre has(h)
+     * @pre comp_(k, key(h))
+     */
+    void decrease_key(Handle h, T const& k)
+    {
+        assert(has(h));
+        assert(comp_(k, keys_[h]));
+        keys_[h] = k;
+        shift_up(position_[h]);
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /**
+     * @brief Set a key that goes down (i.e. greater for a min-heap).
+     * @pre has(h)
+     * @pre comp_(key(h), k)
+     */
+    void increase_key(Handle h, T const& k)
+    {
+        assert(has(h));
+        assert(comp_(keys_[h], k));
+        keys_[h] = k;
+        shift_down(position_[h]);
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /**
+     * @brief Insert or update the key of a handle.
+     * An equivalent key (neither goes before the other) is set in place,
+     * so it works with strict and non strict comparators.
+     * @post has(h) and key(h)==k
+     */
+    void set_key(Handle h, T const& k)
+    {
+        if (! has(h))
+            insert(h, k);
+        else
+        {
+            const bool up = comp_(k, keys_[h]);
+            const bool down = comp_(keys_[h], k);
+            if (up && !down)
+                decrease_key(h, k);
+            else if (down && !up)
+                increase_key(h, k);
+            else
+                keys_[h] = k;
+        }
+    }
+
+  /** @}*/
+
+protected:
+
+    /** @brief Slot value for the handles out of the heap.*/
+    static const size_t NONE = std::numeric_limits<size_t>::max();
+
+    size_t parent(size_t i) const
+    {
+        assert(i>0);
+        return (i-1) / Arity;
+    }
+
+    size_t first_child(size_t i) const
+    {
+        return Arity*i + 1;
+    }
+
+    /** @brief Swap two slots updating the position map.*/
+    void swap_slots(size_t i, size_t j)
+    {
+        std::swap(heap_[i], heap_[j]);
+        position_[heap_[i]] = i;
+        position_[heap_[j]] = j;
+    }
+
+    /** @brief Shift up a slot while its key is strictly "lesser" than
+     * the parent's one.
+     */
+    void shift_up(size_t i)
+    {
+        const Handle h = heap_[i];
+        while (i > 0 && comp_(keys_[h], keys_[heap_[parent(i)]]) &&
+               !comp_(keys_[heap_[parent(i)]], keys_[h]))
+        {
+            heap_[i] = heap_[parent(i)];
+            position_[heap_[i]] = i;
+            i = parent(i);
+        }
+        heap_[i] = h;
+        position_[h] = i;
+    }
+
+    /** @brief Shift down a slot moving a hole as Heap::shit_down() does.*/
+    void shift_down(size_t i)
+    {
+        const Handle h = heap_[i];
+        const size_t n_items = heap_.size();
+        while (true)
+        {
+            const size_t l = first_child(i);
+            if (l >= n_items)
+                break;
+            const size_t r = std::min(l + Arity, n_items);
+            size_t n = l;
+            for (size_t c = l+1; c < r; ++c)
+                if (comp_(keys_[heap_[c]], keys_[heap_[n]]))
+                    n = c;
+            if (comp_(keys_[h], keys_[heap_[n]]))
+                break;
+            heap_[i] = heap_[n];
+            position_[heap_[i]] = i;
+            i = n;
+        }
+        heap_[i] = h;
+        position_[h] = i;
+    }
+
+    /** @brief Check the heap invariant and the position map.*/
+    bool is_a_heap() const
+    {
+        for (size_t i = 0; i < heap_.size(); ++i)
+        {
+            if (position_[heap_[i]] != i)
+                return false;
+            if (i > 0 && comp_(keys_[heap_[i]], keys_[heap_[parent(i)]]) &&
+                !comp_(keys_[heap_[parent(i)]], keys_[heap_[i]]))
+                return false;
+        }
+        return true;
+    }
+
+    Comp comp_; //Functor to compare heap items. comp_(it1, it2)
+    std::vector<T> keys_;          //key by handle.
+    std::vector<size_t> position_; //heap slot by handle (NONE if absent).
+    std::vector<Handle> heap_;     //handles in heap order.
+};
+
+template<class T, class Comp, size_t Arity>
+const size_t IndexedHeap<T, Comp, Arity>::NONE;
+
+#endif
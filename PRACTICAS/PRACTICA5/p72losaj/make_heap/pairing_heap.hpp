@@ -0,0 +1,382 @@
+#ifndef __ED_PairingHeap_HPP__
+#define __ED_PairingHeap_HPP__
+
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "heap.hpp"
+
+/**
+ * @brief Implement a Pairing Heap.
+ * It is an addressable heap: insert() returns a handle of the new key that
+ * can be used later to update or erase the key.
+ * insert() and decrease_key() are O(1) and remove(), erase() and
+ * increase_key() are O(log n) amortized, so it is an alternative to
+ * IndexedHeap when the handles are not known in advance or there are much
+ * more decrease_key() than remove() calls.
+ *
+ * The parameter template Comp must implement the interface:
+ *          bool operator()(T const& a, T const& b)
+ * as in Heap<T, Comp, Arity>, i.e. std::less_equal<T> for a min-heap.
+ *
+ * The nodes are stored in an array and linked by their indexes. A node
+ * links its first child, its next sibling and its previous sibling (or its
+ * parent for a first child). The slots of the erased nodes are reused.
+ */
+template<class T, class Comp = std::less_equal<T>>
+class PairingHeap
+{
+  public:
+
+    /** @brief Identifier of a key.*/
+    typedef size_t Handle;
+
+    /** @brief Handle used as null link.*/
+    static const Handle NONE = std::numeric_limits<Handle>::max();
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+    /**
+     * @brief Create an empty Heap.
+     * @post is_empty()
+     */
+    PairingHeap ():
+        root_(NONE), free_(NONE), size_(0)
+    {
+        assert(is_empty());
+    }
+
+  /** @}*/
+
+  /** @name Observers*/
+  /** @{*/
+
+    /** @brief is the heap empty?.*/
+    bool is_empty () const
+    {
+        return size_ == 0;
+    }
+
+    /** @brief Get the heap size. */
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /** @brief Is the handle into the heap?*/
+    bool has(Handle h) const
+    {
+        return h < nodes_.size() && nodes_[h].used;
+    }
+
+    /** @brief Get the key of a handle.
+     * @pre has(h)
+     */
+    T const& key(Handle h) const
+    {
+        assert(has(h));
+        return nodes_[h].key;
+    }
+
+    /** @brief Get the root key.
+     * @pre not is_empty();
+     */
+    T const& top() const
+    {
+        assert(! is_empty());
+        return nodes_[root_].key;
+    }
+
+    /** @brief Get the handle of the root key.
+     * @pre not is_empty();
+     */
+    Handle top_handle() const
+    {
+        assert(! is_empty());
+        return root_;
+    }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+  /** @{*/
+
+    /**
+     * @brief Reserve room for n keys.
+     */
+    void reserve(size_t n)
+    {
+        nodes_.reserve(n);
+    }
+
+    /**
+     * @brief insert a new key.
+     * @return the handle of the key.
+     * @post not is_empty()
+     */
+    Handle insert (T const& k)
+    {
+        Handle h = new_node();
+        nodes_[h].key = k;
+        root_ = meld(root_, h);
+        ++size_;
+
+        HEAP_CHECK(is_a_heap());
+        return h;
+    }
+
+    /** @brief Remove the root key.
+     * @pre not is_empty()
+     */
+    void remove()
+    {
+        assert(! is_empty());
+        Handle old_root = root_;
+        root_ = merge_pairs(nodes_[old_root].child);
+        free_node(old_root);
+        --size_;
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /** @brief Remove the root key and get it.
+     * @pre not is_empty()
+     */
+    T pop()
+    {
+        assert(! is_empty());
+        T old_top = std::move(nodes_[root_].key);
+        remove();
+        return old_top;
+    }
+
+    /**
+     * @brief Remove the key of a handle.
+     * @warning the handle can be reused by a later insert().
+     * @pre has(h)
+     * @post not has(h)
+     */
+    void erase(Handle h)
+    {
+        assert(has(h));
+        if (h == root_)
+        {
+            remove();
+            return;
+        }
+        cut(h);
+        root_ = meld(root_, merge_pairs(nodes_[h].child));
+        free_node(h);
+        --size_;
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /**
+     * @brief Set a key that goes up (i.e. lower for a min-heap).
+     * The subtree of the node is cut and melded with the root.
+     * @pre has(h)
+     * @pre comp_(k, key(h))
+     */
+    void decrease_key(Handle h, T const& k)
+    {
+        assert(has(h));
+        assert(comp_(k, nodes_[h].key));
+        nodes_[h].key = k;
+        if (h != root_)
+        {
+            cut(h);
+            root_ = meld(root_, h);
+        }
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /**
+     * @brief Set a key that goes down (i.e. greater for a min-heap).
+     * The children of the node are merged and the node is inserted again
+     * keeping its handle.
+     * @pre has(h)
+     * @pre comp_(key(h), k)
+     */
+    void increase_key(Handle h, T const& k)
+    {
+        assert(has(h));
+        assert(comp_(nodes_[h].key, k));
+        Handle children = nodes_[h].child;
+        nodes_[h].child = NONE;
+        nodes_[h].key = k;
+        if (h == root_)
+            root_ = meld(h, merge_pairs(children));
+        else
+        {
+            cut(h);
+            root_ = meld(root_, meld(h, merge_pairs(children)));
+        }
+
+        HEAP_CHECK(is_a_heap());
+    }
+
+    /**
+     * @brief Update the key of a handle.
+     * @pre has(h)
+     * @post key(h)==k
+     */
+    void set_key(Handle h, T const& k)
+    {
+        if (comp_(k, nodes_[h].key))
+            decrease_key(h, k);
+        else
+            increase_key(h, k);
+    }
+
+    /** @brief Remove all the keys.
+     * @post is_empty()
+     */
+    void clear()
+    {
+        nodes_.clear();
+        root_ = NONE;
+        free_ = NONE;
+        size_ = 0;
+    }
+
+  /** @}*/
+
+protected:
+
+    struct Node
+    {
+        T key;
+        Handle child; //first child.
+        Handle next;  //next sibling (or next free node).
+        Handle prev;  //previous sibling or parent if it is the first child.
+        bool used;
+    };
+
+    Handle new_node()
+    {
+        Handle h = free_;
+        if (h != NONE)
+            free_ = nodes_[h].next;
+        else
+        {
+            h = nodes_.size();
+            nodes_.push_back(Node());
+        }
+        nodes_[h].child = nodes_[h].next = nodes_[h].prev = NONE;
+        nodes_[h].used = true;
+        return h;
+    }
+
+    void free_node(Handle h)
+    {
+        nodes_[h].used = false;
+        nodes_[h].next = free_;
+        free_ = h;
+    }
+
+    /** @brief Unlink a non root node (and its subtree) from its parent.*/
+    void cut(Handle h)
+    {
+        Node& n = nodes_[h];
+        assert(n.prev != NONE);
+        if (nodes_[n.prev].child == h)
+            nodes_[n.prev].child = n.next;
+        else
+            nodes_[n.prev].next = n.next;
+        if (n.next != NONE)
+            nodes_[n.next].prev = n.prev;
+        n.next = n.prev = NONE;
+    }
+
+    /** @brief Meld two trees, the root with the "greater" key becomes the
+     * first child of the other one.
+     */
+    Handle meld(Handle a, Handle b)
+    {
+        if (a == NONE)
+            return b;
+        if (b == NONE)
+            return a;
+        if (!comp_(nodes_[a].key, nodes_[b].key))
+            std::swap(a, b);
+        Node& child = nodes_[b];
+        child.next = nodes_[a].child;
+        child.prev = a;
+        if (child.next != NONE)
+            nodes_[child.next].prev = b;
+        nodes_[a].child = b;
+        nodes_[a].next = nodes_[a].prev = NONE;
+        return a;
+    }
+
+    /**
+     * @brief Merge a list of siblings into a tree.
+     * The siblings are melded in pairs from left to right and then the pairs
+     * are melded from right to left.
+     */
+    Handle merge_pairs(Handle first)
+    {
+        pairs_.clear();
+        while (first != NONE)
+        {
+            Handle a = first;
+            Handle b = nodes_[a].next;
+            first = (b != NONE) ? nodes_[b].next : NONE;
+            nodes_[a].next = nodes_[a].prev = NONE;
+            if (b != NONE)
+                nodes_[b].next = nodes_[b].prev = NONE;
+            pairs_.push_back(meld(a, b));
+        }
+        Handle tree = NONE;
+        while (!pairs_.empty())
+        {
+            tree = meld(pairs_.back(), tree);
+            pairs_.pop_back();
+        }
+        return tree;
+    }
+
+    /** @brief Check the heap invariant and the links.*/
+    bool is_a_heap() const
+    {
+        if (root_ == NONE)
+            return size_ == 0;
+        if (nodes_[root_].prev != NONE || nodes_[root_].next != NONE)
+            return false;
+        size_t count = 0;
+        std::vector<Handle> stack(1, root_);
+        while (!stack.empty())
+        {
+            Handle p = stack.back();
+            stack.pop_back();
+            ++count;
+            Handle prev = p;
+            for (Handle c = nodes_[p].child; c != NONE; c = nodes_[c].next)
+            {
+                if (nodes_[c].prev != prev || !comp_(nodes_[p].key, nodes_[c].key))
+                    return false;
+                stack.push_back(c);
+                prev = c;
+            }
+        }
+        return count == size_;
+    }
+
+    Comp comp_; //Functor to compare heap items. comp_(it1, it2)
+    std::vector<Node> nodes_;
+    std::vector<Handle> pairs_; //scratch space for merge_pairs().
+    Handle root_;
+    Handle free_; //first free node.
+    size_t size_;
+};
+
+template<class T, class Comp>
+const typename PairingHeap<T, Comp>::Handle PairingHeap<T, Comp>::NONE;
+
+#endif
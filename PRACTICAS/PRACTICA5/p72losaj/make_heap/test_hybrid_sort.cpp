@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "heap.hpp"
+#include "heapsort.hpp"
+#include "test_check.hpp"
+
+/** @brief Generate n values in [0, range).*/
+template<class T>
+std::vector<T>
+make_values(size_t n, int range, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, range - 1);
+    std::vector<T> values(n);
+    for (size_t i = 0; i < n; ++i)
+        values[i] = static_cast<T>(dist(rng));
+    return values;
+}
+
+/**
+ * @brief hybrid_sort() must give the same order as heapsort() with the
+ * same comparator, with one thread and in parallel.
+ */
+template<class T, class Comp>
+void
+test_same_as_heapsort(std::string const& name, size_t n, int range)
+{
+    std::vector<T> expected = make_values<T>(n, range, static_cast<unsigned>(n));
+    std::vector<T> sequential = expected;
+    std::vector<T> parallel = expected;
+
+    heapsort<T, Comp>(expected);
+    hybrid_sort<T, Comp>(sequential, Comp(), 1);
+    hybrid_sort<T, Comp>(parallel, Comp(), 4);
+
+    const std::string what = name + " n=" + std::to_string(n) +
+                             " range=" + std::to_string(range);
+    check(sequential == expected, what + " (one thread)");
+    check(parallel == expected, what + " (four threads)");
+}
+
+template<class T, class Comp>
+void
+test_comparator(std::string const& name)
+{
+    const size_t sizes[] = {0, 1, 2, 15, 16, 17, 100, 1000, 100000, 300000};
+    const int ranges[] = {1, 3, 1000000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); ++r)
+            test_same_as_heapsort<T, Comp>(name, sizes[s], ranges[r]);
+}
+
+int
+main()
+{
+    //The strict comparators with heavy duplicates used to overrun the
+    //partition loops of introsort.
+    test_comparator<int, std::less<int>>("less<int>");
+    test_comparator<int, std::greater<int>>("greater<int>");
+    test_comparator<int, std::less_equal<int>>("less_equal<int>");
+    test_comparator<int, std::greater_equal<int>>("greater_equal<int>");
+    test_comparator<double, std::less_equal<double>>("less_equal<double>");
+    test_comparator<double, std::less<double>>("less<double>");
+
+    return checks_result();
+}
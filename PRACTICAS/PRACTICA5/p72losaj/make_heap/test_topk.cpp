@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "topk.hpp"
+#include "test_check.hpp"
+
+/**
+ * @brief The selection must be the first k items of the values sorted
+ * with hybrid_sort(), pushing one by one, by blocks and in parallel.
+ */
+template<class Comp>
+void
+test_top_k(std::string const& name, size_t n, size_t k, int range)
+{
+    std::mt19937 rng(static_cast<unsigned>(n + k));
+    std::uniform_int_distribution<int> dist(0, range - 1);
+    std::vector<int> values(n);
+    for (size_t i = 0; i < n; ++i)
+        values[i] = dist(rng);
+
+    std::vector<int> expected = values;
+    hybrid_sort<int, Comp>(expected, Comp(), 1);
+    expected.resize(std::min(n, k));
+
+    const std::string what = name + " n=" + std::to_string(n) +
+                             " k=" + std::to_string(k) +
+                             " range=" + std::to_string(range);
+
+    TopK<int, Comp> one_by_one(k);
+    for (size_t i = 0; i < n; ++i)
+        one_by_one.push(values[i]);
+    check(one_by_one.sorted() == expected, what + " (push)");
+
+    TopK<int, Comp> batch(k);
+    batch.push_batch(values.data(), values.data() + n);
+    check(batch.size() <= batch.k(), what + " (size <= k)");
+    check(batch.size() == expected.size(), what + " (size)");
+    check(batch.sorted() == expected, what + " (push_batch)");
+
+    check(parallel_top_k<int, Comp>(values, k, 4) == expected, what + " (parallel)");
+}
+
+int
+main()
+{
+    //The strict comparators with heavy duplicates used to overrun the
+    //nth_element() of flush().
+    const size_t ks[] = {1, 10, 5000};
+    const int ranges[] = {3, 1000000};
+    for (size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); ++i)
+        for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); ++r)
+        {
+            test_top_k<std::less<int>>("less<int>", 300000, ks[i], ranges[r]);
+            test_top_k<std::less_equal<int>>("less_equal<int>", 300000, ks[i], ranges[r]);
+            test_top_k<std::greater_equal<int>>("greater_equal<int>", 1000, ks[i], ranges[r]);
+        }
+
+    return checks_result();
+}
@@ -0,0 +1,220 @@
+#ifndef __ED_TopK_HPP__
+#define __ED_TopK_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "heap.hpp"
+#include "heapsort.hpp"
+
+/**
+ * @brief Select the top K items of a stream using O(K) memory.
+ * The selected items are kept into a Heap<T, Comp> of K items whose root is
+ * the worst selected item, so a new item only enters when it is better than
+ * the root, replacing it.
+ *
+ * The order is the same as heapsort():
+ * You can use std::less_equal to select the K greatest items.
+ * You can use std::greater_equal to select the K lesser items.
+ *
+ * push_batch() is a fast path for blocks of items: the items better than the
+ * root are collected and, when there are enough of them, the K best of the
+ * heap and the collected items are selected with a partial sort and the heap
+ * is rebuilt, so most items cost a single comparison.
+ */
+template<class T, class Comp = std::less_equal<T>>
+class TopK
+{
+  public:
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+    /**
+     * @brief Create an empty selector of k items.
+     * @pre k > 0
+     * @post is_empty()
+     */
+    TopK (size_t k):
+        k_(k), heap_(static_cast<int>(k))
+    {
+        assert(k > 0);
+        assert(is_empty());
+    }
+
+  /** @}*/
+
+  /** @name Observers*/
+  /** @{*/
+
+    /** @brief Get the number of items to select.*/
+    size_t k() const
+    {
+        return k_;
+    }
+
+    /** @brief Get the number of items selected.
+     * The collected items not flushed yet are counted as selected, up to
+     * k() items, because flush() keeps the k best of them and the heap.
+     * @post size() <= k()
+     */
+    size_t size() const
+    {
+        return std::min(k_, heap_.size() + candidates_.size());
+    }
+
+    /** @brief is the selection empty?*/
+    bool is_empty() const
+    {
+        return size() == 0;
+    }
+
+    /** @brief Get the worst selected item.
+     * An item must be better than it to be selected.
+     * @pre not is_empty()
+     */
+    T const& threshold()
+    {
+        flush();
+        assert(! is_empty());
+        return heap_.top();
+    }
+
+    /** @brief Get the selected items from the best to the worst.*/
+    std::vector<T> sorted()
+    {
+        flush();
+        std::vector<T> values(heap_.data(), heap_.data() + heap_.size());
+        hybrid_sort<T, Comp>(values, comp_, 1);
+        return values;
+    }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+  /** @{*/
+
+    /**
+     * @brief Push an item.
+     * @return true if the item is selected (until better items arrive).
+     */
+    bool push(T const& item)
+    {
+        flush();
+        if (static_cast<size_t>(heap_.size()) < k_)
+        {
+            heap_.insert(item);
+            return true;
+        }
+        if (comp_(item, heap_.top()))
+            return false;
+        heap_.replace_top(item);
+        return true;
+    }
+
+    /** @brief Push a block of items.*/
+    void push_batch(T const* first, T const* last)
+    {
+        //Fill the heap first.
+        while (first != last && static_cast<size_t>(heap_.size()) < k_)
+            heap_.insert(*first++);
+
+        for (; first != last; ++first)
+            if (! comp_(*first, heap_.top()))
+            {
+                candidates_.push_back(*first);
+                if (candidates_.size() >= std::max(k_, MIN_CANDIDATES))
+                    flush();
+            }
+    }
+
+    /** @brief Push the items selected by other selector.*/
+    void merge(TopK<T, Comp>& other)
+    {
+        other.flush();
+        push_batch(other.heap_.data(), other.heap_.data() + other.heap_.size());
+    }
+
+    /**
+     * @brief Select the K best of the heap and the collected items.
+     * The heap is rebuilt with them.
+     */
+    void flush()
+    {
+        if (candidates_.empty())
+            return;
+
+        std::vector<T> values = heap_.release();
+        values.insert(values.end(), candidates_.begin(), candidates_.end());
+        candidates_.clear();
+        if (values.size() > k_)
+        {
+            std::nth_element(values.begin(), values.begin() + (k_-1), values.end(),
+                             HeapsortBefore<T, Comp>(comp_));
+            values.resize(k_);
+        }
+        values.reserve(k_);
+        heap_ = Heap<T, Comp>(std::move(values));
+    }
+
+  /** @}*/
+
+protected:
+
+    /** @brief Minimum number of collected items to rebuild the heap.*/
+    static const size_t MIN_CANDIDATES = 1024;
+
+    size_t k_;
+    Comp comp_; //Functor to compare heap items. comp_(it1, it2)
+    Heap<T, Comp> heap_;
+    std::vector<T> candidates_; //items collected by push_batch().
+};
+
+template<class T, class Comp>
+const size_t TopK<T, Comp>::MIN_CANDIDATES;
+
+/**
+ * @brief Select the top K items of an array in parallel.
+ * Each thread selects the top K items of its part of the array and then
+ * the selections are merged.
+ * @arg n_threads is the number of threads to use (0 means the hardware
+ * concurrency).
+ * @return the selected items from the best to the worst.
+ */
+template<class T, class Comp>
+std::vector<T>
+parallel_top_k(std::vector<T> const& values, size_t k, size_t n_threads=0)
+{
+    //Minimum number of items per thread.
+    static const size_t MIN_ITEMS_PER_THREAD = 1 << 16;
+
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::max<size_t>(1, std::min(n_threads, values.size() / MIN_ITEMS_PER_THREAD));
+
+    std::vector< TopK<T, Comp> > selectors;
+    for (size_t t = 0; t < n_threads; ++t)
+        selectors.push_back(TopK<T, Comp>(k));
+    auto worker = [&](size_t t)
+    {
+        T const* data = values.data();
+        selectors[t].push_batch(data + values.size() * t / n_threads,
+                                data + values.size() * (t+1) / n_threads);
+        selectors[t].flush();
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < n_threads; ++t)
+        threads.push_back(std::thread(worker, t));
+    worker(0);
+    for (size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    for (size_t t = 1; t < n_threads; ++t)
+        selectors[0].merge(selectors[t]);
+    return selectors[0].sorted();
+}
+
+#endif
@@ -0,0 +1,385 @@
+#ifndef __ED_AVLMap_HPP__
+#define __ED_AVLMap_HPP__
+
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "avltree_pool.hpp"
+
+/**
+ * @brief Order the entries of an AVLMap by their keys.
+ * A key can also be compared with an entry, so the lookups do not need to
+ * build an entry.
+ */
+template <class K, class V, class Compare = std::less<K>>
+struct AVLMapKeyCompare
+{
+    typedef std::pair<K, V> Entry;
+
+    AVLMapKeyCompare(Compare const& c=Compare()): comp(c)
+    {}
+
+    bool operator()(Entry const& a, Entry const& b) const
+    {
+        return comp(a.first, b.first);
+    }
+
+    bool operator()(K const& a, Entry const& b) const
+    {
+        return comp(a, b.first);
+    }
+
+    bool operator()(Entry const& a, K const& b) const
+    {
+        return comp(a.first, b);
+    }
+
+    Compare comp;
+};
+
+template <class K, class V, class Compare> class AVLMap;
+
+/**
+ * @brief A bidirectional in order iterator of an AVLMap.
+ * It moves following the parent links, so walking k entries from a node
+ * costs O(k) amortized, without descending again from the root.
+ *
+ * Entry is the type of the entries seen: std::pair<K, V> for an iterator,
+ * so it->second can be changed, or std::pair<K, V> const for a
+ * const_iterator. An iterator converts to a const_iterator.
+ * @warning the entry's key must not be changed.
+ * @warning insert() and erase() invalidate the iterators.
+ */
+template <class K, class V, class Compare = std::less<K>,
+          class Entry = std::pair<K, V>>
+class AVLMapIterator
+{
+public:
+
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef std::pair<K, V> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Entry* pointer;
+    typedef Entry& reference;
+
+    typedef AVLMap<K, V, Compare> Map;
+    typedef typename std::conditional<std::is_const<Entry>::value,
+                                      Map const, Map>::type MapType;
+    typedef typename Map::Ref Ref;
+
+    AVLMapIterator(): map_(nullptr)
+    {}
+
+    AVLMapIterator(MapType* map, Ref node): map_(map), node_(node)
+    {}
+
+    /** @brief Convert an iterator to a const_iterator.*/
+    template <class Other>
+    AVLMapIterator(AVLMapIterator<K, V, Compare, Other> const& other):
+        map_(other.map_), node_(other.node_)
+    {}
+
+    /** @brief Get the entry.*/
+    reference operator*() const
+    {
+        return map_->entry_at(node_);
+    }
+
+    pointer operator->() const
+    {
+        return &map_->entry_at(node_);
+    }
+
+    /** @brief Get the key.*/
+    K const& key() const
+    {
+        return node_->item().first;
+    }
+
+    /** @brief Get the value.*/
+    typename std::conditional<std::is_const<Entry>::value, V const, V>::type&
+    value() const
+    {
+        return map_->entry_at(node_).second;
+    }
+
+    AVLMapIterator& operator++()
+    {
+        node_ = node_->next();
+        return *this;
+    }
+
+    AVLMapIterator operator++(int)
+    {
+        AVLMapIterator old(*this);
+        ++(*this);
+        return old;
+    }
+
+    /** @brief Go to the previous entry (the end goes to the last one).*/
+    AVLMapIterator& operator--()
+    {
+        node_ = node_ ? node_->prev() : map_->last_node();
+        return *this;
+    }
+
+    AVLMapIterator operator--(int)
+    {
+        AVLMapIterator old(*this);
+        --(*this);
+        return old;
+    }
+
+    template <class Other>
+    bool operator==(AVLMapIterator<K, V, Compare, Other> const& other) const
+    {
+        return node_ == other.node_;
+    }
+
+    template <class Other>
+    bool operator!=(AVLMapIterator<K, V, Compare, Other> const& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    template <class, class, class, class> friend class AVLMapIterator;
+
+    MapType* map_;
+    Ref node_;
+};
+
+/** @brief A range [begin, end) of an AVLMap usable in a range-for.*/
+template <class Iterator>
+struct AVLMapRange
+{
+    Iterator first;
+    Iterator last;
+
+    Iterator begin() const
+    {
+        return first;
+    }
+
+    Iterator end() const
+    {
+        return last;
+    }
+};
+
+/**
+ * @brief An ordered map implemented as an AVLTree of (key, value) entries.
+ * The entries are stored into a PoolAVLTree, so lookups are O(log n) and
+ * the range queries (range(), lower_bound() + iteration) are O(log n + k)
+ * because the iteration follows the node links.
+ *
+ * The keys are ordered by Compare, a strict weak order as std::less<K>.
+ */
+template <class K, class V, class Compare = std::less<K>>
+class AVLMap: protected PoolAVLTree<std::pair<K, V>, AVLMapKeyCompare<K, V, Compare>>
+{
+    typedef PoolAVLTree<std::pair<K, V>, AVLMapKeyCompare<K, V, Compare>> Tree;
+
+  public:
+
+    typedef std::pair<K, V> value_type;
+    typedef typename Tree::Ref Ref;
+    typedef AVLMapIterator<K, V, Compare> iterator;
+    typedef AVLMapIterator<K, V, Compare, value_type const> const_iterator;
+    typedef AVLMapRange<iterator> range_type;
+    typedef AVLMapRange<const_iterator> const_range_type;
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+    /** @brief Create an empty map.
+     * @post is_empty()
+     */
+    AVLMap(Compare const& comp=Compare()):
+        Tree(AVLMapKeyCompare<K, V, Compare>(comp))
+    {}
+
+  /** @}*/
+
+  /** @name Observers*/
+  /** @{*/
+
+    using Tree::is_empty;
+    using Tree::size;
+    using Tree::height;
+
+    /** @brief Has the map got this key?*/
+    bool has(K const& k) const
+    {
+        return bool(Tree::find(k));
+    }
+
+    /** @brief Get the entry with a key.
+     * @return end() if the key is not found.
+     */
+    iterator find(K const& k)
+    {
+        return make_iterator(Tree::find(k));
+    }
+
+    const_iterator find(K const& k) const
+    {
+        return make_iterator(Tree::find(k));
+    }
+
+    /** @brief Get the first entry whose key is not lesser than k.*/
+    iterator lower_bound(K const& k)
+    {
+        return make_iterator(Tree::lower_bound(k));
+    }
+
+    const_iterator lower_bound(K const& k) const
+    {
+        return make_iterator(Tree::lower_bound(k));
+    }
+
+    /** @brief Get the first entry whose key is greater than k.*/
+    iterator upper_bound(K const& k)
+    {
+        return make_iterator(Tree::upper_bound(k));
+    }
+
+    const_iterator upper_bound(K const& k) const
+    {
+        return make_iterator(Tree::upper_bound(k));
+    }
+
+    /** @brief Get the entries with a key in [lo, hi).*/
+    range_type range(K const& lo, K const& hi)
+    {
+        range_type r = {lower_bound(lo), lower_bound(hi)};
+        if (!comp_keys(lo, hi))
+            r.first = r.last;
+        return r;
+    }
+
+    const_range_type range(K const& lo, K const& hi) const
+    {
+        const_range_type r = {lower_bound(lo), lower_bound(hi)};
+        if (!comp_keys(lo, hi))
+            r.first = r.last;
+        return r;
+    }
+
+    iterator begin()
+    {
+        return make_iterator(Tree::first());
+    }
+
+    const_iterator begin() const
+    {
+        return make_iterator(Tree::first());
+    }
+
+    iterator end()
+    {
+        return make_iterator(Ref());
+    }
+
+    const_iterator end() const
+    {
+        return make_iterator(Ref());
+    }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+  /** @{*/
+
+    using Tree::clear;
+    using Tree::reserve;
+
+    /**
+     * @brief Insert an entry if the key is not into the map.
+     * @return true if the entry was inserted.
+     * @post has(k)
+     */
+    bool insert(K const& k, V const& v)
+    {
+        if (has(k))
+            return false;
+        Tree::insert(value_type(k, v));
+        return true;
+    }
+
+    /** @brief Get the value of a key, inserting a default value if the key
+     * is not into the map.
+     * @post has(k)
+     */
+    V& operator[](K const& k)
+    {
+        Ref n = Tree::find(k);
+        if (!n)
+        {
+            Tree::insert(value_type(k, V()));
+            n = this->current_node();
+        }
+        return value_at(n);
+    }
+
+    /**
+     * @brief Remove the entry with a key.
+     * @return true if the entry was into the map.
+     * @post not has(k)
+     */
+    bool erase(K const& k)
+    {
+        Ref n = Tree::find(k);
+        if (!n)
+            return false;
+        this->current_ = n.index();
+        Tree::remove();
+        return true;
+    }
+
+  /** @}*/
+
+protected:
+
+    template <class, class, class, class> friend class AVLMapIterator;
+
+    iterator make_iterator(Ref const& n)
+    {
+        return iterator(this, n);
+    }
+
+    const_iterator make_iterator(Ref const& n) const
+    {
+        return const_iterator(this, n);
+    }
+
+    Ref last_node() const
+    {
+        return Tree::last();
+    }
+
+    V& value_at(Ref const& n)
+    {
+        return entry_at(n).second;
+    }
+
+    value_type& entry_at(Ref const& n)
+    {
+        return this->_nodes[n.index()].item;
+    }
+
+    value_type const& entry_at(Ref const& n) const
+    {
+        return this->_nodes[n.index()].item;
+    }
+
+    bool comp_keys(K const& a, K const& b) const
+    {
+        return this->key_comp().comp(a, b);
+    }
+};
+
+#endif
@@ -1,14 +1,145 @@
 #ifndef __ED_AVLTree_HPP__
 #define __ED_AVLTree_HPP__
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <memory>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-/** @brief a AVLTree's Node.*/
+/**
+ * @brief Check an O(n) tree invariant.
+ * The invariant checks visit the whole tree, so they are only run when the
+ * macro __AVL_DEBUG_CHECKS is defined (i.e. -D__AVL_DEBUG_CHECKS).
+ */
+#ifdef __AVL_DEBUG_CHECKS
+#define AVL_CHECK(expr) assert(expr)
+#else
+#define AVL_CHECK(expr)
+#endif
+
+/**
+ * @name Augmentation policies.
+ * A policy keeps into each node an aggregate of the items of its subtree.
+ * It must define:
+ * - value_type: the aggregate type.
+ * - identity(): the aggregate of an empty subtree.
+ * - from_item(item): the aggregate of an item.
+ * - combine(a, b): the aggregate of two consecutive ranges (associative).
+ */
+/** @{*/
+
+/** @brief Policy without aggregate.*/
+template <class T>
+struct AVLNoAugment
+{
+    struct value_type {};
+
+    static value_type identity()
+    {
+        return value_type();
+    }
+
+    static value_type from_item(T const&)
+    {
+        return value_type();
+    }
+
+    static value_type combine(value_type const&, value_type const&)
+    {
+        return value_type();
+    }
+};
+
+/** @brief Sum of the items of a subtree.
+ * The sums are accumulated as Acc, so a wider type (i.e.
+ * AVLSumAugment<int, long long>) keeps the sum of many items from
+ * overflowing.
+ */
+template <class T, class Acc = T>
+struct AVLSumAugment
+{
+    typedef Acc value_type;
+
+    static value_type identity()
+    {
+        return Acc();
+    }
+
+    static value_type from_item(T const& item)
+    {
+        return static_cast<Acc>(item);
+    }
+
+    static value_type combine(value_type const& a, value_type const& b)
+    {
+        return a + b;
+    }
+};
+
+/** @brief Minimum item of a subtree.*/
+template <class T>
+struct AVLMinAugment
+{
+    typedef T value_type;
+
+    static value_type identity()
+    {
+        return std::numeric_limits<T>::has_infinity ?
+                    std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+
+    static value_type from_item(T const& item)
+    {
+        return item;
+    }
+
+    static value_type combine(value_type const& a, value_type const& b)
+    {
+        return b < a ? b : a;
+    }
+};
+
+/** @brief Maximum item of a subtree.*/
 template <class T>
+struct AVLMaxAugment
+{
+    typedef T value_type;
+
+    static value_type identity()
+    {
+        return std::numeric_limits<T>::has_infinity ?
+                    -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+
+    static value_type from_item(T const& item)
+    {
+        return item;
+    }
+
+    static value_type combine(value_type const& a, value_type const& b)
+    {
+        return a < b ? b : a;
+    }
+};
+
+/** @}*/
+
+/** @brief a AVLTree's Node.
+ * Besides its height, the node keeps the size of its subtree and the
+ * aggregate of its subtree items given by the policy Aug.
+ */
+template <class T, class Aug = AVLNoAugment<T>>
 class AVLTNode
 {
 public:
@@ -18,7 +149,7 @@ public:
      * facility, possibly sharing that management with other objects.
      * @see http://www.cplusplus.com/reference/memory/shared_ptr/
      */
-    typedef std::shared_ptr< AVLTNode<T> > Ref;
+    typedef std::shared_ptr< AVLTNode<T, Aug> > Ref;
 
     /** @name Life cicle.*/
     /** @{*/
@@ -26,8 +157,9 @@ public:
     /** @brief Create a AVLTNode.
      * @post n_children() == 0
      */
-    AVLTNode (T const& it=T(), AVLTNode<T>::Ref parent=nullptr, AVLTNode<T>::Ref left=nullptr, AVLTNode<T>::Ref right=nullptr):
-        _item(it), parent_(parent), left_(left), right_(right), height_(0)
+    AVLTNode (T const& it=T(), AVLTNode<T, Aug>* parent=nullptr, AVLTNode<T, Aug>::Ref left=nullptr, AVLTNode<T, Aug>::Ref right=nullptr):
+        _item(it), parent_(parent), left_(left), right_(right), height_(0),
+        size_(1), aggregate_(Aug::from_item(it))
     {}
 
     /** @brief Destroy a AVLTNode. **/
@@ -51,21 +183,26 @@ public:
         return height_;
     }
 
-    /** @brief Compute the balance factor of the node.*/
+    /** @brief Get the number of nodes of the subtree.*/
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /** @brief Get the aggregate of the subtree items.*/
+    typename Aug::value_type const& aggregate() const
+    {
+        return aggregate_;
+    }
+
+    /** @brief Compute the balance factor of the node.
+     * It is the right child's height minus the left one (-1 if empty).
+     */
     int balance_factor() const
     {
-      int l_h=0, r_h=0;
-      if(has_left())
-      {
-      	left_->compute_height();
-        l_h=left_->height()+1;
-      }
-      if(has_right())
-      {
-      	right_->compute_height();
-        r_h=right_->height()+1;
-      }
-      return r_h-l_h;
+        int l_h = has_left() ? left_->height() : -1;
+        int r_h = has_right() ? right_->height() : -1;
+        return r_h - l_h;
     }
 
     /** @brief Has it a parent?*/
@@ -75,13 +212,13 @@ public:
     }
 
     /** @brief get the parent.*/
-    const AVLTNode<T>::Ref& parent() const
+    AVLTNode<T, Aug> const* parent() const
     {
         return parent_;
     }
 
     /** @brief get the parent.*/
-    AVLTNode<T>::Ref& parent()
+    AVLTNode<T, Aug>* parent()
     {
         return parent_;
     }
@@ -93,13 +230,13 @@ public:
     }
 
     /** @brief get the left child.*/
-    const AVLTNode<T>::Ref& left() const
+    const AVLTNode<T, Aug>::Ref& left() const
     {
         return left_;
     }
 
     /** @brief get the left child.*/
-    AVLTNode<T>::Ref& left()
+    AVLTNode<T, Aug>::Ref& left()
     {
         return left_;
     }
@@ -111,13 +248,13 @@ public:
     }
 
     /** @brief get the right child.*/
-    const AVLTNode<T>::Ref& right() const
+    const AVLTNode<T, Aug>::Ref& right() const
     {
         return right_;
     }
 
     /** @brief get the right child.*/
-    AVLTNode<T>::Ref& right()
+    AVLTNode<T, Aug>::Ref& right()
     {
         return right_;
     }
@@ -134,7 +271,7 @@ public:
     }
 
     /** @brief Set the parent.*/
-    void set_parent(AVLTNode<T>::Ref const& new_parent)
+    void set_parent(AVLTNode<T, Aug>* new_parent)
     {
         parent_ = new_parent;
     }
@@ -142,11 +279,11 @@ public:
     /** @brief Remove link to the left child. */
     void remove_parent()
     {
-        parent_.reset();
+        parent_ = nullptr;
     }
 
     /** @brief Set the left child.*/
-    void set_left(AVLTNode<T>::Ref const& new_child)
+    void set_left(AVLTNode<T, Aug>::Ref const& new_child)
     {
         left_ = new_child;
     }
@@ -158,7 +295,7 @@ public:
     }
 
     /** @brief Set the right child.*/
-    void set_right(AVLTNode<T>::Ref const& new_child)
+    void set_right(AVLTNode<T, Aug>::Ref const& new_child)
     {
         right_ = new_child;
     }
@@ -169,56 +306,59 @@ public:
         right_.reset();
     }
 
-    /** @brief Compute height. */
+    /** @brief Compute the height from the children's heights.
+     * Only this node is updated, the children heights must be right.
+     */
     void compute_height()
     {
-      //NODO NO TIENE HIJOS Y SU PADRE ACABA DE DEJAR DE SER NODO HOJA
-      if(!has_left()&&!has_right())
-      {
-        height_=0;
-        if(has_parent())
-        {
-          parent_->compute_height();
-        }
-        //NODO TIENE HIJOS Y SU ALTURA COINCIDE CON UNA DE LA DE SUS HIJOS
-      }else if(has_right()||has_left())
-      {
-        int l_h=0, r_h=0;
-        if(has_left())
-        {
-          l_h=left_->height();
-        }
-        if(has_right())
-        {
-          r_h=right_->height();
-        } 
-        if(l_h>r_h)
-        {
-          height_=l_h+1;
-        }else
+        int l_h = has_left() ? left_->height() : -1;
+        int r_h = has_right() ? right_->height() : -1;
+        height_ = 1 + (l_h > r_h ? l_h : r_h);
+    }
+
+    /** @brief Compute the subtree size and aggregate from the children's ones.
+     * Only this node is updated, the children values must be right.
+     */
+    void compute_aggregates()
+    {
+        size_ = 1;
+        typename Aug::value_type a = Aug::from_item(_item);
+        if (has_left())
         {
-          height_=r_h+1;
+            size_ += left_->size();
+            a = Aug::combine(left_->aggregate(), a);
         }
-        if(has_parent())
+        if (has_right())
         {
-          parent_->compute_height();
+            size_ += right_->size();
+            a = Aug::combine(a, right_->aggregate());
         }
-      }
+        aggregate_ = a;
     }
 
 protected:
     T _item;
-    AVLTNode<T>::Ref parent_;
-    AVLTNode<T>::Ref left_;
-    AVLTNode<T>::Ref right_;
+    AVLTNode<T, Aug>* parent_; //not owned, so the links have no cycles.
+    AVLTNode<T, Aug>::Ref left_;
+    AVLTNode<T, Aug>::Ref right_;
     int height_;
+    size_t size_;
+    typename Aug::value_type aggregate_;
 };
 
 /**
  * @brief ADT AVLTree.
  * Models a AVLTree of T.
+ *
+ * The heights are kept in the nodes and updated locally, so insert() and
+ * remove() are O(log n). The O(n) invariant checks are only run when the
+ * macro __AVL_DEBUG_CHECKS is defined (see AVL_CHECK).
+ *
+ * The nodes also keep their subtree sizes, so rank() and select() are
+ * O(log n), and the subtree aggregates given by the policy Aug (i.e.
+ * AVLSumAugment<T>), so aggregate(lo, hi) is O(log n).
  */
-template<class T>
+template<class T, class Aug = AVLNoAugment<T>>
 class AVLTree
 {
   public:
@@ -234,6 +374,7 @@ class AVLTree
       _root=nullptr;
       parent_=nullptr;
       current_=nullptr;
+      n_rotations_=0;
     }
 
     /**
@@ -241,10 +382,10 @@ class AVLTree
      * @post not is_empty()
      * @post not current_exists()
     */
-    AVLTree (typename AVLTNode<T>::Ref& new_root)
+    AVLTree (typename AVLTNode<T, Aug>::Ref& new_root)
     {
-        _root=new_root;
-        current_=nullptr;
+        n_rotations_=0;
+        set_root(new_root);
         assert(!is_empty());
         assert(!current_exists());
     }
@@ -262,11 +403,7 @@ class AVLTree
   /** @brief is the list empty?.*/
   bool is_empty () const
   {
-      if(_root==nullptr)
-      {
-          return true;
-      }
-      return false;
+      return _root==nullptr;
   }
 
   /** @brief Get the root item.
@@ -274,17 +411,14 @@ class AVLTree
    */
   T const& item() const
   {
+      assert(!is_empty());
       return _root->item();
   }
 
   /** @brief Is the cursor at a valid position?*/
   bool current_exists() const
   {
-      if(current_!=nullptr)
-      {
-        return true;
-      }
-      return false;
+      return current_!=nullptr;
   }
 
   /**
@@ -294,53 +428,166 @@ class AVLTree
   T const& current() const
   {
       //check preconditions.
-      assert(current_exists());      
+      assert(current_exists());
       return current_->item();
   }
 
   /** @brief Get the root node.*/
-  typename AVLTNode<T>::Ref const& root() const
+  typename AVLTNode<T, Aug>::Ref const& root() const
   {
       return _root;
   }
 
   /** @brief Get the root node.*/
-  typename AVLTNode<T>::Ref root()
+  typename AVLTNode<T, Aug>::Ref root()
   {
       return _root;
   }
 
   /** @brief Has the tree got this key */
   bool has(const T& k) const
+  {
+      return find(k)!=nullptr;
+  }
+
+  /**
+   * @brief Find the node with a key without moving the cursor.
+   * It does not change the tree, so several threads can call it at the
+   * same time while there are no writers.
+   * @return the node or nullptr if the key is not found.
+   */
+  AVLTNode<T, Aug> const* find(const T& k) const
   {
       //check invariants.
-      assert(is_a_binary_search_subtree(root()));
-      assert(is_a_balanced_subtree(root()));
-      if(_root==nullptr)
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
+
+      AVLTNode<T, Aug> const* cursor=_root.get();
+      while(cursor!=nullptr)
       {
-        return false;
+        if(k<cursor->item())
+          cursor=cursor->left().get();
+        else if(cursor->item()<k)
+          cursor=cursor->right().get();
+        else
+          break;
       }
-      typename AVLTNode<T>::Ref cursor=_root;
-      bool found=false;
-      bool ended=false;
-      do
+      return cursor;
+  }
+
+  /** @brief Get the number of keys.*/
+  size_t size() const
+  {
+      return _root==nullptr ? 0 : _root->size();
+  }
+
+  /** @brief Get the number of rotations done by insert() and remove().*/
+  size_t rotations() const
+  {
+      return n_rotations_;
+  }
+
+  /**
+   * @brief Get the number of keys lesser than k.
+   * @post has(k) implies select(rank(k))==k
+   */
+  size_t rank(T const& k) const
+  {
+      size_t r = 0;
+      AVLTNode<T, Aug> const* cursor=_root.get();
+      while(cursor!=nullptr)
       {
-        if(cursor->item()==k)
+        if(cursor->item()<k)
         {
-            found=true;
-        }else if((cursor->has_left())&&(cursor->item()>k))
+          r += 1 + subtree_size(cursor->left().get());
+          cursor=cursor->right().get();
+        }
+        else
+          cursor=cursor->left().get();
+      }
+      return r;
+  }
+
+  /**
+   * @brief Get the i-th key in order (zero based).
+   * @pre i < size()
+   * @post rank(select(i))==i
+   */
+  T const& select(size_t i) const
+  {
+      assert(i < size());
+      AVLTNode<T, Aug> const* cursor=_root.get();
+      while(true)
+      {
+        const size_t l_s = subtree_size(cursor->left().get());
+        if(i<l_s)
+          cursor=cursor->left().get();
+        else if(i==l_s)
+          return cursor->item();
+        else
         {
-            cursor=cursor->left();
-        }else if((cursor->has_right())&&(cursor->item()<k))
+          i -= l_s + 1;
+          cursor=cursor->right().get();
+        }
+      }
+  }
+
+  /** @brief Get the aggregate of all the keys.*/
+  typename Aug::value_type aggregate() const
+  {
+      return _root==nullptr ? Aug::identity() : _root->aggregate();
+  }
+
+  /**
+   * @brief Get the aggregate of the keys in [lo, hi).
+   * The subtrees fully inside the range give their aggregates, so it visits
+   * O(log n) nodes: the path to the node where lo and hi split and the
+   * two boundary paths below it.
+   */
+  typename Aug::value_type aggregate(T const& lo, T const& hi) const
+  {
+      //Find the split node: the first one with lo <= item < hi.
+      AVLTNode<T, Aug> const* split=_root.get();
+      while(split!=nullptr)
+      {
+        if(split->item()<lo)
+          split=split->right().get();
+        else if(!(split->item()<hi))
+          split=split->left().get();
+        else
+          break;
+      }
+      if(split==nullptr)
+        return Aug::identity();
+
+      //Left boundary: the keys >= lo of the left subtree (right to left).
+      typename Aug::value_type left_acc = Aug::identity();
+      for(AVLTNode<T, Aug> const* n=split->left().get(); n!=nullptr;)
+        if(n->item()<lo)
+          n=n->right().get();
+        else
         {
-            cursor=cursor->right();
-        }else
+          left_acc = Aug::combine(Aug::combine(Aug::from_item(n->item()),
+                                               subtree_aggregate(n->right().get())),
+                                  left_acc);
+          n=n->left().get();
+        }
+
+      //Right boundary: the keys < hi of the right subtree (left to right).
+      typename Aug::value_type right_acc = Aug::identity();
+      for(AVLTNode<T, Aug> const* n=split->right().get(); n!=nullptr;)
+        if(n->item()<hi)
         {
-            ended=true;
+          right_acc = Aug::combine(right_acc,
+                                   Aug::combine(subtree_aggregate(n->left().get()),
+                                                Aug::from_item(n->item())));
+          n=n->right().get();
         }
+        else
+          n=n->left().get();
 
-      }while((found==false)&&(ended==false));
-      return found;
+      return Aug::combine(Aug::combine(left_acc, Aug::from_item(split->item())),
+                          right_acc);
   }
 
   /** @}*/
@@ -349,13 +596,21 @@ class AVLTree
 
   /** @{*/
 
-  /** @brief set a new root node.*/
-  void set_root(typename AVLTNode<T>::Ref& new_root)
+  /** @brief set a new root node.
+   * The parent links and the heights of the subtree are (re)computed.
+   */
+  void set_root(typename AVLTNode<T, Aug>::Ref& new_root)
   {
       _root=new_root;
-      _root->compute_height();
-      assert(is_a_binary_search_subtree(root()));
-     assert(is_a_balanced_subtree(root()));
+      current_=nullptr;
+      parent_=nullptr;
+      if(_root!=nullptr)
+      {
+        _root->remove_parent();
+        link_subtree(_root);
+      }
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
   }
 
   /**
@@ -366,42 +621,22 @@ class AVLTree
   bool search(T const& k)
   {
       //check invariants.
-      assert(is_a_binary_search_subtree(_root));
-      assert(is_a_balanced_subtree(_root));
-      bool found = false;
-      bool limit = false;
-      current_ = _root;
-      do
-      {
-          if(current()==k)
-          {
-              found=true;
-          }else if((current_->has_left())&&(current()>k))
-          {
-              current_=current_->left();
-          }else if((current_->has_right())&&(current()<k))
-          {
-              current_=current_->right();
-          }else
-          {
-              limit=true;
-          }
-      }while((found==false)&&(limit==false));
-
+      AVL_CHECK(is_a_binary_search_subtree(_root));
+      AVL_CHECK(is_a_balanced_subtree(_root));
 
-      //check invariants.
-      assert(is_a_binary_search_subtree(_root));
-      assert(is_a_balanced_subtree(_root));
-      if((limit==true)&&(found==false))
-      {
-          current_=nullptr;
-      }else
+      current_ = _root;
+      while(current_!=nullptr)
       {
-        if(current_->has_parent())
-        {
-          parent_=current_->parent();
-        }
+        if(k<current())
+          current_=current_->left();
+        else if(current()<k)
+          current_=current_->right();
+        else
+          break;
       }
+      bool found = current_exists();
+      parent_ = found ? parent_ref(current_.get()) : nullptr;
+
       assert(!found || current()==k);
       assert(found || !current_exists());
       return found;
@@ -419,70 +654,31 @@ class AVLTree
       assert(! has(k));
 
       //check invariants.
-      assert(is_a_binary_search_subtree(root()));
-	  assert(is_a_balanced_subtree(root()));
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
 
-      //TODO
-      //First delivery, only the invariant for a Binary Search Tree
-      //must be met.
-      if(_root==nullptr)
-      {
-        typename AVLTNode<T>::Ref new_node = std::make_shared<AVLTNode<T>>();
-        new_node->set_item(k);
-        set_root(new_node);
-        current_=_root;
-      }else
+      //Find the parent of the new leaf.
+      parent_=nullptr;
+      typename AVLTNode<T, Aug>::Ref cursor=_root;
+      while(cursor!=nullptr)
       {
-        current_=_root;
-        bool settled=false;
-        do
-        {
-          if(current_exists()==true)
-          {
-            if(k<current())
-            {
-              if(current_->has_left())
-              {
-                current_=current_->left();
-              }else
-              {
-                typename AVLTNode<T>::Ref new_node = std::make_shared<AVLTNode<T>>();
-                new_node->set_item(k);
-                new_node->set_parent(current_);
-                current_->set_left(new_node);
-                current_=current_->left();
-                parent_=current_->parent();
-                current_->compute_height(); //Para computar alturas desde current
-                settled=true;
-              }
-            }else
-            {
-               if(current_->has_right())
-              {
-                current_=current_->right();
-              }else
-              {
-                typename AVLTNode<T>::Ref new_node = std::make_shared<AVLTNode<T>>();
-                new_node->set_item(k);
-                new_node->set_parent(current_);
-                current_->set_right(new_node);
-                current_=current_->right();
-                parent_=current_->parent();
-                current_->compute_height(); //Para computar alturas desde current
-                settled=true;
-              }
-            }
-          }
-        }while(settled==false);
+        parent_=cursor;
+        cursor= k<cursor->item() ? cursor->left() : cursor->right();
       }
 
-      ////////////////////////
-      
+      current_ = std::make_shared<AVLTNode<T, Aug>>(k, parent_.get());
+      if(parent_==nullptr)
+        _root=current_;
+      else if(k<parent_->item())
+        parent_->set_left(current_);
+      else
+        parent_->set_right(current_);
+
       make_balanced();
-      
+
       //check invariants.
-      assert(is_a_binary_search_subtree(root()));
-      assert(is_a_balanced_subtree(root()));
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
 
       //check postconditions.
       assert(current_exists());
@@ -499,612 +695,1015 @@ class AVLTree
       //check preconditions.
       assert(current_exists());
 
-      // @WARNING Here, we must not check invariants because this function could be called
-      // in recursion and then the invariants are not met.
+      //Remove case 3: the node takes the key of its in order sucessor,
+      //which has not left child, and the sucessor is removed instead.
+      if(current_->has_left()&&current_->has_right())
+      {
+        auto tmp = current_;
+        find_inorder_sucessor();
+        tmp->set_item(current_->item());
+      }
 
-      bool replace_with_subtree = true;
-      typename AVLTNode<T>::Ref subtree;
+      //Remove cases 1 and 2: replace the node by its subtree (may be empty).
+      typename AVLTNode<T, Aug>::Ref subtree =
+          current_->has_left() ? current_->left() : current_->right();
+      parent_=parent_ref(current_.get());
+      if(subtree!=nullptr)
+        subtree->set_parent(parent_.get());
+      if(parent_==nullptr)
+        _root=subtree;
+      else if(parent_->left()==current_)
+        parent_->set_left(subtree);
+      else
+        parent_->set_right(subtree);
+      current_->remove_parent();
+      current_=nullptr;
 
+      make_balanced();
 
-      //TODO: first delivery
-      //Check if there are one subtree (may be empty) to replace node to be removed.
-      if(current_->has_left()||current_->has_right())
-      {
-        if(current_->has_left()&&current_->has_right())
-        {
-          replace_with_subtree=false;
-        }else
-        {
-          if(current_->has_left())
-          {
-            subtree=current_->left();
-          }else if(current_->has_right())
-          {
-            subtree=current_->right();
-          }
-        }
-        if(replace_with_subtree)//Caso 1 y 2 tiene un nodo hijo.
-        {
-            //TODO: first delivery
-            //Replace the node with the subtree.
-            if(current_->parent()==nullptr)//en caso en el que vayamos a borrar root
-            {
-              _root=subtree;
-              current_=nullptr;
-            }else//caso en el que el current a borrar no es root
-            {
-              parent_=current_->parent();
-              if(parent_->right()->item()==current())
-              {
-                parent_->set_right(subtree);
-                current_=nullptr;
-              }else
-              {
-
-                parent_->set_left(subtree);
-                current_=nullptr;
-              }
-            }
-        }
-        else
-        {
-            //Remove case 3.
-            auto tmp = current_;
-            find_inorder_sucessor();
-            tmp->set_item(current_->item());
-            remove();
-        }
-      }else//caso 0: no tiene nodos hijos
-      {
-        parent_=current_->parent();
+      //check invariants.
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
 
-        if(parent_->has_left()&&parent_->left()->item()==current())
-        {
-          parent_->remove_left();
-          current_=nullptr;
-        }else
-        {
-          parent_->remove_right();
-          current_=nullptr;
-        }
-        assert(! current_exists());
-      }
-      make_balanced();
-            //check invariants.
-            assert(is_a_binary_search_subtree(root()));
-            assert(is_a_balanced_subtree(root()));
+      //check postconditions.
+      assert(! current_exists());
+  }
+
+  /**
+   * @brief Replace the tree by the keys of a sorted range.
+   * The middle key is the root and both halves are built the same way, so
+   * the tree is perfectly balanced and it is built in O(n) without
+   * rotations. The halves of large ranges are built in parallel.
+   * @arg n_threads is the number of threads to use (0 means the hardware
+   * concurrency).
+   * @pre [first, last) is strictly increasing.
+   * @post size() == last - first
+   * @post not current_exists()
+   */
+  template <class RandomIt>
+  void build_from_sorted(RandomIt first, RandomIt last, size_t n_threads=1)
+  {
+      assert(first <= last);
+      AVL_CHECK(std::adjacent_find(first, last,
+                                   [](T const& a, T const& b) {return !(a<b);}) == last);
+      if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+      adopt_root(build_subtree(first, static_cast<size_t>(last - first), n_threads));
+
+      //check invariants.
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
+      assert(size() == static_cast<size_t>(last - first));
+  }
+
+  /**
+   * @brief Move the keys of other to the end of this tree.
+   * It takes O(|height() - other.height()| + 1).
+   * @pre other's keys are greater than this tree's keys.
+   * @post other.is_empty()
+   */
+  void join(AVLTree<T, Aug>& other)
+  {
+      assert(is_empty() || other.is_empty() || select(size()-1) < other.select(0));
+      typename AVLTNode<T, Aug>::Ref r = other.release_root();
+      adopt_root(join_subtrees(release_root(), r));
+
+      //check invariants.
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
+      assert(other.is_empty());
+  }
+
+  /**
+   * @brief Split the tree by a key.
+   * This tree keeps the keys lesser than k and greater receives the keys
+   * greater than k. It takes O(log n).
+   * @return true if k was into the tree (it is removed).
+   * @pre greater.is_empty()
+   * @post not has(k) and not greater.has(k)
+   */
+  bool split(T const& k, AVLTree<T, Aug>& greater)
+  {
+      assert(greater.is_empty());
+      typename AVLTNode<T, Aug>::Ref l, r;
+      bool found = split_subtree(release_root(), k, l, r) != nullptr;
+      adopt_root(l);
+      greater.adopt_root(r);
 
-            //check postconditions.
-            assert(! current_exists());
+      //check invariants.
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
+      AVL_CHECK(is_a_binary_search_subtree(greater.root()));
+      AVL_CHECK(is_a_balanced_subtree(greater.root()));
+      assert(!has(k));
+      return found;
+  }
 
-      // @WARNING Here, we must not check the
-      // postconditions and invariants because this function could be called
-      // in recursion and then the invariants are not met.
+  /**
+   * @brief This tree gets the keys of both trees.
+   * The algorithms split the other tree by the root key and recur on the
+   * halves, so merging a tree of m keys with one of n >= m keys takes
+   * O(m log(n/m + 1)).
+   * @post other.is_empty()
+   */
+  void set_union(AVLTree<T, Aug>& other)
+  {
+      typename AVLTNode<T, Aug>::Ref r = other.release_root();
+      adopt_root(union_subtrees(release_root(), r));
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
   }
 
+  /**
+   * @brief This tree keeps the keys that are also into other.
+   * @see set_union() for the cost.
+   * @post other.is_empty()
+   */
+  void set_intersection(AVLTree<T, Aug>& other)
+  {
+      typename AVLTNode<T, Aug>::Ref r = other.release_root();
+      adopt_root(intersect_subtrees(release_root(), r));
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
+  }
 
+  /**
+   * @brief This tree removes the keys that are into other.
+   * @see set_union() for the cost.
+   * @post other.is_empty()
+   */
+  void set_difference(AVLTree<T, Aug>& other)
+  {
+      typename AVLTNode<T, Aug>::Ref r = other.release_root();
+      adopt_root(subtract_subtrees(release_root(), r));
+      AVL_CHECK(is_a_binary_search_subtree(root()));
+      AVL_CHECK(is_a_balanced_subtree(root()));
+  }
 
   /** @}*/
 
 private:
 
   /** @brief desactivate Copy constructor. */
-  AVLTree(const AVLTree<T>& other);
+  AVLTree(const AVLTree<T, Aug>& other);
 
   /** @brief desactivate assign operator. */
-  AVLTree<T>& operator =(const AVLTree<T>& other);
+  AVLTree<T, Aug>& operator =(const AVLTree<T, Aug>& other);
 
 protected:
 
   /**
    * @brief Move current to its in order sucessor.
+   * @pre current_->has_right()
    */
   void find_inorder_sucessor()
   {
-    auto l=current_->left();
-    auto r=current_->right();
-    if(r->has_left())
-    {
-      current_=r->left();
-    }else if(!r->has_left()&& !r->has_right())
-    {
-      current_=r;
-    }else if(l->has_right())
-    {
-      current_=l->right();
-    }else
+    assert(current_->has_right());
+    current_=current_->right();
+    while(current_->has_left())
+      current_=current_->left();
+  }
+
+  /**
+   * @brief Set the parent links, the heights, sizes and aggregates of a subtree.
+   * It is a postfix traversal without recursion.
+   */
+  void link_subtree(typename AVLTNode<T, Aug>::Ref const& node)
+  {
+    std::vector<std::pair<AVLTNode<T, Aug>*, bool>> stack;
+    stack.push_back(std::make_pair(node.get(), false));
+    while(!stack.empty())
     {
-      current_=l;
+      AVLTNode<T, Aug>* n = stack.back().first;
+      if(stack.back().second)
+      {
+        stack.pop_back();
+        n->compute_height();
+        n->compute_aggregates();
+        continue;
+      }
+      stack.back().second = true;
+      if(n->has_left())
+      {
+        n->left()->set_parent(n);
+        stack.push_back(std::make_pair(n->left().get(), false));
+      }
+      if(n->has_right())
+      {
+        n->right()->set_parent(n);
+        stack.push_back(std::make_pair(n->right().get(), false));
+      }
     }
   }
 
-
-  /**
-   * @brief make a left rotation.
-   * @warning it is posible there is none grand parent (==nullptr).
+  /** @name Bulk operations on detached subtrees.
+   * The subtrees have not parent and they are consumed by the operations.
    */
-  void rotate_left(typename AVLTNode<T>::Ref& child,
-                   typename AVLTNode<T>::Ref& parent,
-                   typename AVLTNode<T>::Ref& grand_parent)
+  /** @{*/
+
+  /** @brief Minimum number of keys to build the halves in parallel.*/
+  static const size_t AVL_BUILD_PARALLEL_MIN = 1 << 15;
+
+  /** @brief Get the height of a subtree (-1 if empty).*/
+  static int subtree_height(typename AVLTNode<T, Aug>::Ref const& n)
   {
-      //TODO: second delivery.
-      //First update grand parent link.
-      //If there is not grand parent, the child will be
-      //the new root of the tree.
-     if(grand_parent!=nullptr)
-     {
-        //ACTUALIZAMOS LINKS
-        if(parent->has_left())
-        {
-          auto l=parent->left();
-          grand_parent->set_right(l);
-          l->set_parent(grand_parent);
-          parent->remove_left();
-        }else
-        {
-          grand_parent->remove_right();
-          
-        }
+    return n==nullptr ? -1 : n->height();
+  }
 
-        if(grand_parent->has_parent())
-        {
-          auto p_gp=grand_parent->parent();
-          if(p_gp->right()==grand_parent)
-          {
-            p_gp->set_right(parent);
-          }else
-          {
-            p_gp->set_left(parent);
-          }
-          parent->set_parent(p_gp);
-          grand_parent->set_parent(parent);
-          parent->set_left(grand_parent);
-        }else
-        {
-          parent->remove_parent();
-          grand_parent->set_parent(parent);
-          parent->set_left(grand_parent);
-        }
-        if(_root->has_parent())
-        {
-          _root=_root->parent();
-        }
-
-      }else
-      {//REVISAR POR UNION INFINITA
-        if(parent->has_parent())
-        {
-          auto p_p = parent->parent();
-          if(p_p->left()==parent)
-          {
-            p_p->set_left(child);
-            child->set_parent(p_p);
-          }else
-          {
-            p_p->set_right(child);        
-            child->set_parent(p_p);
-          }
-          parent->set_parent(child);
-          parent->remove_right();
-          if(child->has_left())
-          {
-          	auto l=child->left();
-          	l->set_parent(parent);
-          	parent->set_right(l);
-          }
-          child->set_left(parent);
-        }else
-        {
-          parent->set_parent(child);
-          parent->remove_right();
-          child->remove_parent();
-          child->set_left(parent);
-        }
-      }
-      //ACTUALIZAMOS LA VARIABLE ROOT DEL ARBOL EN CASO DE VERSE MODIFICADA
-      //CALCULAMOS ALTURAS DE PARENT Y CHILD
-      if(grand_parent!=nullptr)
-      {
-        parent->compute_height();     
-      }else
-      {
-        parent->compute_height();
-        child->compute_height();
-      }   
-
-      
-      //TODO: second delivery.
-      //second update child<->parent links.
+  /** @brief Take the nodes of the tree, leaving it empty.*/
+  typename AVLTNode<T, Aug>::Ref release_root()
+  {
+    typename AVLTNode<T, Aug>::Ref r = _root;
+    _root=nullptr;
+    current_=nullptr;
+    parent_=nullptr;
+    return r;
+  }
 
+  /** @brief Use a detached subtree as the tree.*/
+  void adopt_root(typename AVLTNode<T, Aug>::Ref const& r)
+  {
+    _root=r;
+    if(_root!=nullptr)
+      _root->remove_parent();
+    current_=nullptr;
+    parent_=nullptr;
+  }
 
+  /** @brief Link a node with its new children and update it.*/
+  static void set_children(typename AVLTNode<T, Aug>::Ref const& n,
+                           typename AVLTNode<T, Aug>::Ref l,
+                           typename AVLTNode<T, Aug>::Ref r)
+  {
+    n->set_left(l);
+    if(l!=nullptr)
+      l->set_parent(n.get());
+    n->set_right(r);
+    if(r!=nullptr)
+      r->set_parent(n.get());
+    n->compute_height();
+    n->compute_aggregates();
+  }
 
-      //TODO: second delivery.
-      //Update heigths for parent, child and grandparent if there is.
+  /** @brief Unlink the children of a subtree's root.*/
+  static void take_children(typename AVLTNode<T, Aug>::Ref const& n,
+                            typename AVLTNode<T, Aug>::Ref& l,
+                            typename AVLTNode<T, Aug>::Ref& r)
+  {
+    l=n->left();
+    r=n->right();
+    n->remove_left();
+    n->remove_right();
+    if(l!=nullptr)
+      l->remove_parent();
+    if(r!=nullptr)
+      r->remove_parent();
+  }
 
+  /** @brief Rotate a detached subtree to the left.*/
+  static typename AVLTNode<T, Aug>::Ref rotate_subtree_left(typename AVLTNode<T, Aug>::Ref n)
+  {
+    typename AVLTNode<T, Aug>::Ref c = n->right();
+    set_children(n, n->left(), c->left());
+    set_children(c, n, c->right());
+    return c;
+  }
 
+  /** @brief Rotate a detached subtree to the right.*/
+  static typename AVLTNode<T, Aug>::Ref rotate_subtree_right(typename AVLTNode<T, Aug>::Ref n)
+  {
+    typename AVLTNode<T, Aug>::Ref c = n->left();
+    set_children(n, c->right(), n->right());
+    set_children(c, c->left(), n);
+    return c;
   }
+
   /**
-   * @brief make a right rotation.
-   * @warning it is posible there is none grand parent (==nullptr).
+   * @brief Build a perfectly balanced subtree with n sorted keys.
+   * @arg n_threads is the number of threads that can be used.
    */
-
-  void rotate_right(typename AVLTNode<T>::Ref& child,
-                    typename AVLTNode<T>::Ref& parent,
-                    typename AVLTNode<T>::Ref& grand_parent)
+  template <class RandomIt>
+  static typename AVLTNode<T, Aug>::Ref build_subtree(RandomIt first, size_t n, size_t n_threads)
   {
-      //TODO: second delivery.
-      //First update grand parent link.
-      //If there is not grand parent, the child will be
-      //the new root of the tree.
-      if(grand_parent!=nullptr)
-     {
-        //ACTUALIZAMOS LINKS
-        if(parent->has_right())
-        {
-          auto r=parent->right();
-          grand_parent->set_left(r);
-          r->set_parent(grand_parent);
-          parent->remove_right();
-        }else
-        {
-          grand_parent->remove_left();
-
-        }
+    if(n==0)
+      return nullptr;
+    const size_t mid = n/2;
+    typename AVLTNode<T, Aug>::Ref node = std::make_shared<AVLTNode<T, Aug>>(first[mid]);
+    typename AVLTNode<T, Aug>::Ref l, r;
+    if(n_threads>1 && n>=AVL_BUILD_PARALLEL_MIN)
+    {
+      std::thread left_task([&]()
+      {
+        l = build_subtree(first, mid, n_threads/2);
+      });
+      r = build_subtree(first+(mid+1), n-mid-1, n_threads-n_threads/2);
+      left_task.join();
+    }
+    else
+    {
+      l = build_subtree(first, mid, 1);
+      r = build_subtree(first+(mid+1), n-mid-1, 1);
+    }
+    set_children(node, l, r);
+    return node;
+  }
 
-        if(grand_parent->has_parent())
-        {
-          auto p_gp=grand_parent->parent();
-          if(p_gp->left()==grand_parent)
-          {
-            p_gp->set_left(parent);
-          }else
-          {
-            p_gp->set_right(parent);
-          }
-          parent->set_parent(p_gp);
-          grand_parent->set_parent(parent);
-          parent->set_right(grand_parent);
-        }else
-        {
-          parent->remove_parent();
-          grand_parent->set_parent(parent);
-          parent->set_right(grand_parent);
-        }
+  /**
+   * @brief Join two subtrees using a pivot node.
+   * The keys of l must be lesser than the pivot's key and the keys of r
+   * greater. The pivot goes down the spine of the higher subtree until
+   * both heights are close, so it takes O(|h(l) - h(r)| + 1).
+   * @return the joined subtree.
+   */
+  static typename AVLTNode<T, Aug>::Ref join_subtrees(typename AVLTNode<T, Aug>::Ref const& l,
+                                                      typename AVLTNode<T, Aug>::Ref const& pivot,
+                                                      typename AVLTNode<T, Aug>::Ref const& r)
+  {
+    const int h_l = subtree_height(l);
+    const int h_r = subtree_height(r);
+    if(h_l > h_r+1)
+      return join_right(l, pivot, r);
+    if(h_r > h_l+1)
+      return join_left(l, pivot, r);
+    set_children(pivot, l, r);
+    return pivot;
+  }
 
-      }else
-      {
-        if(parent->has_parent())
-        {
-          //exit(0);
-          auto p_p = parent->parent();
-          if(p_p->left()==parent)
-          {
-            p_p->set_left(child);
-          }else
-          {
-            p_p->set_right(child);
-          }
-          parent->set_parent(child);
-          parent->remove_left();
-          if(child->has_right())
-          {
-          	auto r=child->right();
-          	r->set_parent(parent);
-          	parent->set_left(r);
-          }
-          
-	          child->set_right(parent);
-	          child->set_parent(p_p);
-        }else
-        {
-          parent->set_parent(child);
-          parent->remove_left();
-          child->set_right(parent);
-          child->remove_parent();
-        }
-      }
-      //CALCULAMOS ALTURAS DE PARENT Y CHILD
-      if(_root->has_parent())
+  /** @brief Join when l is the higher subtree.*/
+  static typename AVLTNode<T, Aug>::Ref join_right(typename AVLTNode<T, Aug>::Ref const& l,
+                                                   typename AVLTNode<T, Aug>::Ref const& pivot,
+                                                   typename AVLTNode<T, Aug>::Ref const& r)
+  {
+    typename AVLTNode<T, Aug>::Ref c = l->right();
+    if(subtree_height(c) <= subtree_height(r)+1)
+    {
+      set_children(pivot, c, r);
+      if(pivot->height() <= subtree_height(l->left())+1)
       {
-        _root=_root->parent();
+        set_children(l, l->left(), pivot);
+        return l;
       }
-      if(grand_parent!=nullptr)
-      {
-        grand_parent->compute_height();
+      set_children(l, l->left(), rotate_subtree_right(pivot));
+      return rotate_subtree_left(l);
+    }
+    typename AVLTNode<T, Aug>::Ref t = join_right(c, pivot, r);
+    set_children(l, l->left(), t);
+    if(t->height() <= subtree_height(l->left())+1)
+      return l;
+    return rotate_subtree_left(l);
+  }
 
-      }else
+  /** @brief Join when r is the higher subtree.*/
+  static typename AVLTNode<T, Aug>::Ref join_left(typename AVLTNode<T, Aug>::Ref const& l,
+                                                  typename AVLTNode<T, Aug>::Ref const& pivot,
+                                                  typename AVLTNode<T, Aug>::Ref const& r)
+  {
+    typename AVLTNode<T, Aug>::Ref c = r->left();
+    if(subtree_height(c) <= subtree_height(l)+1)
+    {
+      set_children(pivot, l, c);
+      if(pivot->height() <= subtree_height(r->right())+1)
       {
-        parent->compute_height();
-        child->compute_height();
+        set_children(r, pivot, r->right());
+        return r;
       }
+      set_children(r, rotate_subtree_left(pivot), r->right());
+      return rotate_subtree_right(r);
+    }
+    typename AVLTNode<T, Aug>::Ref t = join_left(l, pivot, c);
+    set_children(r, t, r->right());
+    if(t->height() <= subtree_height(r->right())+1)
+      return r;
+    return rotate_subtree_right(r);
+  }
 
+  /**
+   * @brief Join two subtrees without pivot.
+   * The last node of l is unlinked and used as pivot.
+   */
+  static typename AVLTNode<T, Aug>::Ref join_subtrees(typename AVLTNode<T, Aug>::Ref const& l,
+                                                      typename AVLTNode<T, Aug>::Ref const& r)
+  {
+    if(l==nullptr)
+      return r;
+    if(r==nullptr)
+      return l;
+    typename AVLTNode<T, Aug>::Ref last;
+    typename AVLTNode<T, Aug>::Ref rest = split_last(l, last);
+    return join_subtrees(rest, last, r);
+  }
 
-      //TODO: second delivery.
-      //second update child<->parent links.
+  /**
+   * @brief Unlink the last node of a subtree.
+   * @return the subtree without the last node.
+   */
+  static typename AVLTNode<T, Aug>::Ref split_last(typename AVLTNode<T, Aug>::Ref const& n,
+                                                   typename AVLTNode<T, Aug>::Ref& last)
+  {
+    typename AVLTNode<T, Aug>::Ref l, r;
+    take_children(n, l, r);
+    if(r==nullptr)
+    {
+      last = n;
+      return l;
+    }
+    typename AVLTNode<T, Aug>::Ref rest = split_last(r, last);
+    return join_subtrees(l, n, rest);
+  }
+
+  /**
+   * @brief Split a subtree by a key.
+   * The nodes of the search path are joined again with the other pieces.
+   * @arg[out] l gets the keys lesser than k.
+   * @arg[out] r gets the keys greater than k.
+   * @return the unlinked node with the key k if found, else nullptr.
+   */
+  static typename AVLTNode<T, Aug>::Ref split_subtree(typename AVLTNode<T, Aug>::Ref n, T const& k,
+                                                      typename AVLTNode<T, Aug>::Ref& l,
+                                                      typename AVLTNode<T, Aug>::Ref& r)
+  {
+    if(n==nullptr)
+    {
+      l=nullptr;
+      r=nullptr;
+      return nullptr;
+    }
+    typename AVLTNode<T, Aug>::Ref n_l, n_r, found;
+    take_children(n, n_l, n_r);
+    if(k<n->item())
+    {
+      found = split_subtree(n_l, k, l, n_l);
+      r = join_subtrees(n_l, n, n_r);
+    }
+    else if(n->item()<k)
+    {
+      found = split_subtree(n_r, k, n_r, r);
+      l = join_subtrees(n_l, n, n_r);
+    }
+    else
+    {
+      l = n_l;
+      r = n_r;
+      found = n;
+    }
+    return found;
+  }
 
+  /** @brief Get the union of two subtrees.*/
+  static typename AVLTNode<T, Aug>::Ref union_subtrees(typename AVLTNode<T, Aug>::Ref const& a,
+                                                       typename AVLTNode<T, Aug>::Ref const& b)
+  {
+    if(a==nullptr)
+      return b;
+    if(b==nullptr)
+      return a;
+    typename AVLTNode<T, Aug>::Ref a_l, a_r, b_l, b_r;
+    take_children(a, a_l, a_r);
+    split_subtree(b, a->item(), b_l, b_r);
+    return join_subtrees(union_subtrees(a_l, b_l), a, union_subtrees(a_r, b_r));
+  }
 
+  /** @brief Get the intersection of two subtrees.*/
+  static typename AVLTNode<T, Aug>::Ref intersect_subtrees(typename AVLTNode<T, Aug>::Ref const& a,
+                                                           typename AVLTNode<T, Aug>::Ref const& b)
+  {
+    if(a==nullptr || b==nullptr)
+      return nullptr;
+    typename AVLTNode<T, Aug>::Ref a_l, a_r, b_l, b_r;
+    take_children(a, a_l, a_r);
+    const bool found = split_subtree(b, a->item(), b_l, b_r) != nullptr;
+    typename AVLTNode<T, Aug>::Ref l = intersect_subtrees(a_l, b_l);
+    typename AVLTNode<T, Aug>::Ref r = intersect_subtrees(a_r, b_r);
+    return found ? join_subtrees(l, a, r) : join_subtrees(l, r);
+  }
 
-      //TODO: second delivery.
-      //Update heigths for parent, child and grandparent if there is.
+  /** @brief Get the keys of a that are not into b.*/
+  static typename AVLTNode<T, Aug>::Ref subtract_subtrees(typename AVLTNode<T, Aug>::Ref const& a,
+                                                          typename AVLTNode<T, Aug>::Ref const& b)
+  {
+    if(a==nullptr || b==nullptr)
+      return a;
+    typename AVLTNode<T, Aug>::Ref a_l, a_r, b_l, b_r;
+    take_children(b, b_l, b_r);
+    split_subtree(a, b->item(), a_l, a_r);
+    return join_subtrees(subtract_subtrees(a_l, b_l), subtract_subtrees(a_r, b_r));
+  }
 
+  /** @}*/
 
+  /** @brief Get the size of a subtree (0 if empty).*/
+  static size_t subtree_size(AVLTNode<T, Aug> const* n)
+  {
+    return n==nullptr ? 0 : n->size();
+  }
+
+  /** @brief Get the aggregate of a subtree (identity if empty).*/
+  static typename Aug::value_type subtree_aggregate(AVLTNode<T, Aug> const* n)
+  {
+    return n==nullptr ? Aug::identity() : n->aggregate();
+  }
+
+  /** @brief Get the owning reference of a node from its parent link.*/
+  typename AVLTNode<T, Aug>::Ref node_ref(AVLTNode<T, Aug> const* n) const
+  {
+    if(!n->has_parent())
+      return _root;
+    return n->parent()->left().get()==n ? n->parent()->left() : n->parent()->right();
+  }
+
+  /** @brief Get the owning reference of the parent of a node.
+   * @return nullptr for the root.
+   */
+  typename AVLTNode<T, Aug>::Ref parent_ref(AVLTNode<T, Aug> const* n) const
+  {
+    if(!n->has_parent())
+      return nullptr;
+    return node_ref(n->parent());
+  }
+
+  /** @brief Replace the link from the parent of node to node by new_node.
+   * If node has not parent, new_node will be the new root of the tree.
+   */
+  void replace_in_parent(typename AVLTNode<T, Aug>::Ref const& node,
+                         typename AVLTNode<T, Aug>::Ref const& new_node)
+  {
+    auto p = node->parent();
+    new_node->set_parent(p);
+    if(p==nullptr)
+      _root=new_node;
+    else if(p->left()==node)
+      p->set_left(new_node);
+    else
+      p->set_right(new_node);
   }
+
+  /**
+   * @brief make a left rotation of the subtree rooted at node.
+   * @return the new root of the subtree (the old right child).
+   */
+  typename AVLTNode<T, Aug>::Ref rotate_left(typename AVLTNode<T, Aug>::Ref node)
+  {
+      auto child = node->right();
+      replace_in_parent(node, child);
+      ++n_rotations_;
+
+      //The child's left subtree moves to the node's right.
+      node->set_right(child->left());
+      if(node->has_right())
+        node->right()->set_parent(node.get());
+      child->set_left(node);
+      node->set_parent(child.get());
+
+      //Only the node and the child change their heights and subtrees.
+      node->compute_height();
+      node->compute_aggregates();
+      child->compute_height();
+      child->compute_aggregates();
+      return child;
+  }
+
+  /**
+   * @brief make a right rotation of the subtree rooted at node.
+   * @return the new root of the subtree (the old left child).
+   */
+  typename AVLTNode<T, Aug>::Ref rotate_right(typename AVLTNode<T, Aug>::Ref node)
+  {
+      auto child = node->left();
+      replace_in_parent(node, child);
+      ++n_rotations_;
+
+      //The child's right subtree moves to the node's left.
+      node->set_left(child->right());
+      if(node->has_left())
+        node->left()->set_parent(node.get());
+      child->set_right(node);
+      node->set_parent(child.get());
+
+      //Only the node and the child change their heights and subtrees.
+      node->compute_height();
+      node->compute_aggregates();
+      child->compute_height();
+      child->compute_aggregates();
+      return child;
+  }
+
+  /** @brief Update the sizes and aggregates from node up to the root.*/
+  void update_aggregates(AVLTNode<T, Aug>* node)
+  {
+      for(; node!=nullptr; node=node->parent())
+        node->compute_aggregates();
+  }
+
   /**
    * @brief make a balanced tree.
+   * It goes up from parent_ updating the heights and rotating the
+   * unbalanced subtrees. As soon as a subtree keeps its height, the
+   * ancestors do not need rotations, so only their sizes and aggregates
+   * are updated.
    */
   void make_balanced()
   {
       while(parent_)
       {
-          //TODO: second delivery.
           //First, update parent height.
+          const int old_height = parent_->height();
           parent_->compute_height();
+          parent_->compute_aggregates();
 
-          //TODO: second delivery.
           //Second, check balance factors.
           int bf = parent_->balance_factor();
-          if (bf < -1)//ARBOL MAS LARGO EN LA IZQUIERDA
+          if (bf < -1)
           {
-              //The subtree is left un-banlaced.
-              //Get the grand-parent link.
-          	  auto child=parent_->left();
-              //Check the left child balanced factor.
-              int bf_child = child->balance_factor();
-
-              if (bf_child <= 0)
-              {
-              	
-              		auto l=child->left();
-                  typename AVLTNode<T>::Ref null=nullptr;
-                    rotate_right(l,child,parent_);
-
-              }
-              else
-              {
-                  typename AVLTNode<T>::Ref null=nullptr;
-                  auto temp=child->right();
-                  typename AVLTNode<T>::Ref temp2;
-                  rotate_left(temp,child,null);
-                  temp=parent_->left();
-                  temp2=temp->left();
-                  rotate_right(temp2,temp,parent_);
-
-              }
-              
+              //The subtree is left un-balanced.
+              //left-right case needs a previous left rotation.
+              if (parent_->left()->balance_factor() > 0)
+                  rotate_left(parent_->left());
+              parent_ = rotate_right(parent_);
           }
-          else if (bf > 1)//ARBOL MAS LARGO EN LA DERECHA
-          {              
+          else if (bf > 1)
+          {
               //The subtree is right un-balanced.
-              //get the grand-parent link.
-                auto child = parent_->right();
-
-              //Check the child balanced factor.
-              int bf_child = child->balance_factor();
-
-              if (bf_child>=0)
-              {
-                  //TODO: second delivery
-                  //We have a Case 2.
-                  //right-right unbalanced.
-              	auto r=child->right();
-                rotate_left(r,child,parent_);
-              }
-              else
-              {
-                  //TODO: second delivery
-                  //We have a Case 4.
-                  //right-left unbalanced.
-                typename AVLTNode<T>::Ref null=nullptr;
-                auto temp=child->left();
-                rotate_right(temp,child,null);
-
-                typename AVLTNode<T>::Ref  temp2;
-                temp=parent_->right();
-                temp2=temp->right();
-                rotate_left(temp2,temp,parent_);
-                temp->compute_height();
-
-                //exit(0);
-              }
+              //right-left case needs a previous right rotation.
+              if (parent_->right()->balance_factor() < 0)
+                  rotate_right(parent_->right());
+              parent_ = rotate_left(parent_);
           }
-          else
+
+          if (parent_->height() == old_height)
           {
-              //The subtree is balanced. Go up.
-              parent_ = parent_->parent();
+              update_aggregates(parent_->parent());
+              parent_ = nullptr;
           }
+          else
+              parent_ = parent_ref(parent_.get());
       }
   }
+
   /**
    * @brief Check the binary search tree invariant.
+   * It is an in order traversal without recursion that also checks the
+   * parent links.
    * @param node is the subtree's root.
    * @return true of the subtree with node as root is a binary search tree.
    */
-  bool is_a_binary_search_subtree(typename AVLTNode<T>::Ref const& node) const
+  bool is_a_binary_search_subtree(typename AVLTNode<T, Aug>::Ref const& node) const
   {
-      bool r=false;
-      bool l=false;
-      int t=0;//comprueba que se hayan visitado los hijos
-      if(node==nullptr)
+      std::vector<AVLTNode<T, Aug> const*> stack;
+      AVLTNode<T, Aug> const* n = node.get();
+      AVLTNode<T, Aug> const* prev = nullptr;
+      while(n!=nullptr || !stack.empty())
       {
-        return true;
-      }
-      if(node->has_left())
-      {
-          l=true;
-      }
-      if(node->has_right())
-      {
-          r=true;
-      }
-      if((l==false)&&(r==false))
-      {
-        return true;
-      }else
-      {
-          if((l==true))
-          {
-            if(node->item()>node->left()->item())
-            {
-              is_a_binary_search_subtree(node->left());
-              t++;
-            }else
-            {
-              return false;
-            }
-          }
-          if(r==true)
-          {
-            if(node->item()<node->right()->item())
-            {
-             is_a_binary_search_subtree(node->left());
-             t++;
-            }else
-            {
-              return false;
-            }
-          }
-          if(t==0)
-          {
-              return false;
-          }else
-          {
-              return true;
-          }
+        while(n!=nullptr)
+        {
+          if((n->has_left() && n->left()->parent()!=n) ||
+             (n->has_right() && n->right()->parent()!=n))
+            return false;
+          stack.push_back(n);
+          n = n->left().get();
+        }
+        n = stack.back();
+        stack.pop_back();
+        if(prev!=nullptr && !(prev->item()<n->item()))
+          return false;
+        prev = n;
+        n = n->right().get();
       }
+      return true;
   }
 
   /**
    * @brief check the balanced tree invariant.
+   * The heights and sizes kept in the nodes must also be right.
    * @param node is the subtree's root.
    * @return true if the subtree with node as root is balanced.
    */
-  bool is_a_balanced_subtree(typename AVLTNode<T>::Ref const& node) const
+  bool is_a_balanced_subtree(typename AVLTNode<T, Aug>::Ref const& node) const
   {
-  	if(node==nullptr)
-  	{
-  		return true;
-  	}else
-  	{
-		int bf=node->balance_factor();
-		if(bf>=2||bf<=-2)
-		{
-			return false;
-		}
-		if(node->has_right()==false&&node->has_right()==false)
-		{
-			return true;
-		}else
-		{
-			bool r_bf=true, l_bf=true;
-			if(node->has_left())
-			{
-				l_bf=is_a_balanced_subtree(node->left());
-			}
-			if(node->has_right())
-			{
-				r_bf=is_a_balanced_subtree(node->right());
-			}
-			if(r_bf==false||l_bf==false)
-			{
-				return false;
-			}else
-			{
-				return true;
-			}
-		}
-	}
+      std::vector<AVLTNode<T, Aug> const*> stack;
+      if(node!=nullptr)
+        stack.push_back(node.get());
+      while(!stack.empty())
+      {
+        AVLTNode<T, Aug> const* n = stack.back();
+        stack.pop_back();
+        int l_h = n->has_left() ? n->left()->height() : -1;
+        int r_h = n->has_right() ? n->right()->height() : -1;
+        if(n->height() != 1 + (l_h > r_h ? l_h : r_h))
+          return false;
+        if(r_h-l_h>1 || r_h-l_h<-1)
+          return false;
+        size_t l_s = n->has_left() ? n->left()->size() : 0;
+        size_t r_s = n->has_right() ? n->right()->size() : 0;
+        if(n->size() != 1 + l_s + r_s)
+          return false;
+        if(n->has_left())
+          stack.push_back(n->left().get());
+        if(n->has_right())
+          stack.push_back(n->right().get());
+      }
+      return true;
   }
-  typename AVLTNode<T>::Ref _root;
-  typename AVLTNode<T>::Ref current_;
-  typename AVLTNode<T>::Ref parent_;
+
+  typename AVLTNode<T, Aug>::Ref _root;
+  typename AVLTNode<T, Aug>::Ref current_;
+  typename AVLTNode<T, Aug>::Ref parent_;
+  size_t n_rotations_;
 
 };
 
+template<class T, class Aug>
+const size_t AVLTree<T, Aug>::AVL_BUILD_PARALLEL_MIN;
+
 
 /**  @brief Fold an avl tree node.
  * The output format will be:
  * [<item> : <left> : <right>] or [] if its a empty node.
+ * It is a preorder traversal without recursion.
 */
-template<class T>
+template<class T, class Aug = AVLNoAugment<T>>
 std::ostream&
-fold_AVLTNode (std::ostream& out, typename AVLTNode<T>::Ref const& node)
+fold_AVLTNode (std::ostream& out, typename AVLTNode<T, Aug>::Ref const& node)
 {
-    out << '[';
-    if (node != nullptr)
+    //Each node is visited three times: before, between and after its children.
+    std::vector<std::pair<AVLTNode<T, Aug> const*, int>> stack;
+    stack.push_back(std::make_pair(node.get(), 0));
+    while (!stack.empty())
     {
-        out << node->item() << " : ";
-        fold_AVLTNode<T>(out, node->left());
-        out << " : ";
-        fold_AVLTNode<T>(out, node->right());
+        AVLTNode<T, Aug> const* n = stack.back().first;
+        const int visit = stack.back().second++;
+        if (n == nullptr)
+        {
+            out << "[]";
+            stack.pop_back();
+        }
+        else if (visit == 0)
+        {
+            out << '[' << n->item() << " : ";
+            stack.push_back(std::make_pair(n->left().get(), 0));
+        }
+        else if (visit == 1)
+        {
+            out << " : ";
+            stack.push_back(std::make_pair(n->right().get(), 0));
+        }
+        else
+        {
+            out << ']';
+            stack.pop_back();
+        }
     }
-    out << ']';
     return out;
 }
 
 /**  @brief Fold an avl tree. */
-template<class T>
+template<class T, class Aug>
 std::ostream&
-operator << ( std::ostream& out, AVLTree<T> const& tree)
+operator << ( std::ostream& out, AVLTree<T, Aug> const& tree)
 {
-    fold_AVLTNode<T> (out, tree.root());
+    fold_AVLTNode<T, Aug> (out, tree.root());
     return out;
 }
 
+/**
+ * @brief Skip the input until a character is found (it is also skipped).
+ * The characters are taken directly from the stream buffer.
+ * @warning runtime_error will throw if the input ends.
+ */
+inline void
+skip_to_AVLTNode_separator(std::streambuf& buf, char c) noexcept(false)
+{
+    typedef std::char_traits<char> traits;
+    traits::int_type ch = buf.sbumpc();
+    while (!traits::eq_int_type(ch, traits::eof()) && traits::to_char_type(ch) != c)
+        ch = buf.sbumpc();
+    if (traits::eq_int_type(ch, traits::eof()))
+        throw std::runtime_error("Wrong input format.");
+}
+
 /** @brief Load an AVLTNode from a input stream.
+ * The parser has not recursion: the nodes waiting for their right child
+ * are kept into a stack. The separators are read directly from the stream
+ * buffer and the items with operator>>.
  * @return the node on success.
  * @warning runtime_error will throw if worng input format is found.
  */
-template<class T>
+template<class T, class Aug = AVLNoAugment<T>>
 std::istream&
-operator >> (std::istream& in, typename AVLTNode<T>::Ref& node) noexcept(false)
+operator >> (std::istream& in, typename AVLTNode<T, Aug>::Ref& node) noexcept(false)
 {
-    char sep=' ';
-    while(in && sep!='[')
-        in >> sep;
-    if (!in)
-        throw std::runtime_error("Wrong input format.");
-    sep = static_cast<char>(in.peek());
-    if (sep != ']')
+    typedef std::char_traits<char> traits;
+
+    /** @brief A node whose children are being read.*/
+    struct Frame
     {
         T item;
-        in >> item;
-        if (!in)
-            throw std::runtime_error("Wrong input format.");
-        while(in && sep!=':')
-            in >> sep;
-        if (!in)
-            throw std::runtime_error("Wrong input format.");
-        typename AVLTNode<T>::Ref left;
-        in >> left;
-        if (!in)
-            throw std::runtime_error("Wrong input format.");
-        while(in && sep!=':')
-            in >> sep;
-        if (!in)
-            throw std::runtime_error("Wrong input format.");
-        typename AVLTNode<T>::Ref right;
-        in >> right;
-        if (!in)
-            throw std::runtime_error("Wrong input format.");
-        node = std::make_shared< AVLTNode<T> >(item, left, right);
+        typename AVLTNode<T, Aug>::Ref left;
+        bool has_left;
+    };
+
+    std::vector<Frame> stack;
+    std::streambuf* buf = in.rdbuf();
+    if (!in || buf == nullptr)
+        throw std::runtime_error("Wrong input format.");
+    while (true)
+    {
+        //Read a subtree until its item or an empty one.
+        skip_to_AVLTNode_separator(*buf, '[');
+        traits::int_type ch = buf->sgetc();
+        while (!traits::eq_int_type(ch, traits::eof()) && std::isspace(traits::to_char_type(ch)))
+            ch = buf->snextc();
+        typename AVLTNode<T, Aug>::Ref subtree;
+        if (traits::eq_int_type(ch, traits::eof()) || traits::to_char_type(ch) != ']')
+        {
+            Frame frame;
+            in >> frame.item;
+            if (!in)
+                throw std::runtime_error("Wrong input format.");
+            skip_to_AVLTNode_separator(*buf, ':');
+            frame.has_left = false;
+            stack.push_back(frame);
+            continue;
+        }
+        buf->sbumpc();//remove the close bracket from stream.
+
+        //Link the read subtree with the pending nodes.
+        while (!stack.empty() && stack.back().has_left)
+        {
+            skip_to_AVLTNode_separator(*buf, ']');
+            subtree = std::make_shared< AVLTNode<T, Aug> >(stack.back().item, nullptr,
+                                                           stack.back().left, subtree);
+            stack.pop_back();
+        }
+        if (stack.empty())
+        {
+            node = subtree;
+            return in;
+        }
+        stack.back().left = subtree;
+        stack.back().has_left = true;
+        skip_to_AVLTNode_separator(*buf, ':');
     }
-    else
-        in >> sep;//remove the close bracket from stream.
-    return in;
 }
 
 /** @brief Load an avl tree from a input stream.
  * @warning runtime_error will throw if worng input format is found.
  */
-template<class T>
+template<class T, class Aug>
 std::istream&
-operator >> (std::istream& in, AVLTree<T>& tree)
+operator >> (std::istream& in, AVLTree<T, Aug>& tree)
 {
-    typename AVLTNode<T>::Ref root;
-    in >> root;
+    typename AVLTNode<T, Aug>::Ref root;
+    operator>> <T, Aug>(in, root);
     if (in)
         tree.set_root(root);
     return in;
 }
 
+/**
+ * @brief Binary coding of the items of a dump.
+ * The default one copies the bytes of trivially copyable items.
+ */
+template<class T>
+struct AVLBinaryCodec
+{
+    static void write(std::ostream& out, T const* items, size_t n)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "AVLBinaryCodec<T> must be specialized for this type.");
+        out.write(reinterpret_cast<const char*>(items), n * sizeof(T));
+    }
+
+    static bool read(std::istream& in, T* items, size_t n)
+    {
+        in.read(reinterpret_cast<char*>(items), n * sizeof(T));
+        return bool(in);
+    }
+};
+
+/**
+ * @brief The strings are coded as its length followed by its chars.
+ * The length is not trusted: the chars are read by chunks, so a wrong
+ * length fails at the end of the input before a big allocation.
+ */
+template<>
+struct AVLBinaryCodec<std::string>
+{
+
+    static void write(std::ostream& out, std::string const* items, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            const std::uint64_t length = items[i].size();
+            out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.write(items[i].data(), items[i].size());
+        }
+    }
+
+    static bool read(std::istream& in, std::string* items, size_t n)
+    {
+        //Number of chars read at once.
+        static const size_t CHUNK = 1 << 16;
+
+        for (size_t i = 0; i < n && in; ++i)
+        {
+            std::uint64_t length = 0;
+            in.read(reinterpret_cast<char*>(&length), sizeof(length));
+            if (!in)
+                return false;
+            items[i].clear();
+            while (in && items[i].size() < length)
+            {
+                const size_t begin = items[i].size();
+                const size_t part = static_cast<size_t>(
+                            std::min<std::uint64_t>(CHUNK, length - begin));
+                items[i].resize(begin + part);
+                in.read(&items[i][begin], static_cast<std::streamsize>(part));
+            }
+        }
+        return bool(in);
+    }
+};
+
+/** @brief Header of the binary dumps.*/
+static const char AVL_DUMP_MAGIC[8] = {'A', 'V', 'L', 'D', 'U', 'M', 'P', '1'};
+
+/**
+ * @brief Dump an avl tree in binary format.
+ * The format is the header, the number of items (64 bits) and the items in
+ * order coded with AVLBinaryCodec<T>. The items are written by blocks.
+ */
+template<class T, class Aug>
+std::ostream&
+dump_AVLTree (std::ostream& out, AVLTree<T, Aug> const& tree)
+{
+    static const size_t BLOCK = 4096;
+
+    const std::uint64_t n = tree.size();
+    out.write(AVL_DUMP_MAGIC, sizeof(AVL_DUMP_MAGIC));
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+
+    std::vector<T> block;
+    block.reserve(BLOCK);
+    std::vector<AVLTNode<T, Aug> const*> stack;
+    AVLTNode<T, Aug> const* node = tree.root().get();
+    while (node != nullptr || !stack.empty())
+    {
+        while (node != nullptr)
+        {
+            stack.push_back(node);
+            node = node->left().get();
+        }
+        node = stack.back();
+        stack.pop_back();
+        block.push_back(node->item());
+        if (block.size() == BLOCK)
+        {
+            AVLBinaryCodec<T>::write(out, block.data(), block.size());
+            block.clear();
+        }
+        node = node->right().get();
+    }
+    AVLBinaryCodec<T>::write(out, block.data(), block.size());
+    return out;
+}
+
+/**
+ * @brief Load an avl tree from a binary dump.
+ * The items are in order, so the tree is built with
+ * AVLTree::build_from_sorted() in O(n) without rotations.
+ * The number of items is not trusted: they are read by blocks, so a wrong
+ * number fails at the end of the input before a big allocation.
+ * @warning runtime_error will throw if worng input format is found.
+ */
+template<class T, class Aug>
+std::istream&
+load_AVLTree (std::istream& in, AVLTree<T, Aug>& tree) noexcept(false)
+{
+    char magic[sizeof(AVL_DUMP_MAGIC)];
+    std::uint64_t n = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    if (!in || !std::equal(magic, magic + sizeof(magic), AVL_DUMP_MAGIC))
+        throw std::runtime_error("Wrong input format.");
+
+    static const size_t BLOCK = 4096;
+
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        throw std::runtime_error("Wrong input format.");
+    std::vector<T> items;
+    while (items.size() < n)
+    {
+        const size_t begin = items.size();
+        const size_t length = static_cast<size_t>(std::min<std::uint64_t>(BLOCK, n - begin));
+        items.resize(begin + length);
+        if (!AVLBinaryCodec<T>::read(in, items.data() + begin, length))
+            throw std::runtime_error("Wrong input format.");
+    }
+    if (std::adjacent_find(items.begin(), items.end(),
+                           [](T const& a, T const& b) {return !(a<b);}) != items.end())
+        throw std::runtime_error("Wrong input format.");
+    tree.build_from_sorted(items.begin(), items.end());
+    return in;
+}
+
 #endif
@@ -0,0 +1,758 @@
+#ifndef __ED_AVLTree_Pool_HPP__
+#define __ED_AVLTree_Pool_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "avltree.hpp"
+
+template <class T, class Compare> class PoolAVLTree;
+
+/**
+ * @brief a read only reference to a PoolAVLTree's Node.
+ * The nodes live in a contiguous pool owned by the tree and are linked by
+ * 32 bits indexes (parent links included), so a node reference is only a
+ * (tree, index) handle without a control block nor reference counting.
+ *
+ * operator-> returns the handle itself, so code written as node->left()
+ * works as with AVLTNode<T>::Ref.
+ *
+ * @warning a reference is invalidated when its node is removed.
+ */
+template <class T, class Compare = std::less<T>>
+class PoolAVLTNode
+{
+public:
+
+    /** @brief Index of a node into the pool.*/
+    typedef std::uint32_t Index;
+
+    /** @brief Index used as null link.*/
+    static const Index null_index = std::numeric_limits<Index>::max();
+
+    /** @brief A reference to a node is the handle itself.*/
+    typedef PoolAVLTNode<T, Compare> Ref;
+
+    /** @name Life cicle.*/
+    /** @{*/
+
+    /** @brief Create a null reference.*/
+    PoolAVLTNode (std::nullptr_t = nullptr):
+        tree_(nullptr), index_(null_index)
+    {}
+
+    /** @brief Create a reference to the node index of a tree.*/
+    PoolAVLTNode (PoolAVLTree<T, Compare> const* tree, Index index):
+        tree_(index == null_index ? nullptr : tree), index_(index)
+    {}
+
+    /** @}*/
+
+    /** @name Observers.*/
+    /** @{*/
+
+    /** @brief Is it a null reference?*/
+    bool is_null() const
+    {
+        return index_ == null_index;
+    }
+
+    /** @brief Get the node index into the pool.*/
+    Index index() const
+    {
+        return index_;
+    }
+
+    /** @brief Get the data item.
+     * @pre not is_null()
+     */
+    const T& item() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).item;
+    }
+
+    /** @brief Get the node's height (0 for a leaf).*/
+    int height() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).height;
+    }
+
+    /** @brief Has it a parent?*/
+    bool has_parent() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).parent != null_index;
+    }
+
+    /** @brief get the parent.*/
+    Ref parent() const
+    {
+        assert(!is_null());
+        return Ref(tree_, tree_->slot(index_).parent);
+    }
+
+    /** @brief Has it a left child?*/
+    bool has_left() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).left != null_index;
+    }
+
+    /** @brief get the left child.*/
+    Ref left() const
+    {
+        assert(!is_null());
+        return Ref(tree_, tree_->slot(index_).left);
+    }
+
+    /** @brief Has it a right child? */
+    bool has_right() const
+    {
+        assert(!is_null());
+        return tree_->slot(index_).right != null_index;
+    }
+
+    /** @brief get the right child.*/
+    Ref right() const
+    {
+        assert(!is_null());
+        return Ref(tree_, tree_->slot(index_).right);
+    }
+
+    /** @brief get the in order successor (null for the last node).*/
+    Ref next() const
+    {
+        assert(!is_null());
+        return Ref(tree_, tree_->successor(index_));
+    }
+
+    /** @brief get the in order predecessor (null for the first node).*/
+    Ref prev() const
+    {
+        assert(!is_null());
+        return Ref(tree_, tree_->predecessor(index_));
+    }
+
+    /** @brief Access to the node as a AVLTNode<T>::Ref does.*/
+    const Ref* operator->() const
+    {
+        return this;
+    }
+
+    /** @brief Is this reference null?*/
+    explicit operator bool() const
+    {
+        return !is_null();
+    }
+
+    bool operator==(Ref const& other) const
+    {
+        return index_ == other.index_ && (is_null() || tree_ == other.tree_);
+    }
+
+    bool operator!=(Ref const& other) const
+    {
+        return !(*this == other);
+    }
+
+    /** @}*/
+
+protected:
+    PoolAVLTree<T, Compare> const* tree_;
+    Index index_;
+};
+
+template <class T, class Compare>
+const typename PoolAVLTNode<T, Compare>::Index PoolAVLTNode<T, Compare>::null_index;
+
+/**
+ * @brief ADT AVLTree with pooled storage.
+ * Models an AVLTree of T as AVLTree<T> does, with the same cursor API
+ * (search/insert/remove/current), but the nodes are stored in a contiguous
+ * vector and linked by 32 bits indexes, so there are neither reference
+ * cycles nor reference counting, and all the nodes are released together
+ * by clear() or when the tree is destroyed. The slots of the removed nodes
+ * are reused by the next insertions.
+ *
+ * The keys are ordered by Compare, a strict weak order as std::less<T>.
+ */
+template<class T, class Compare = std::less<T>>
+class PoolAVLTree
+{
+  public:
+
+  /** @brief Define a reference to a node.*/
+  typedef typename PoolAVLTNode<T, Compare>::Ref Ref;
+
+  /** @brief Index of a node into the pool.*/
+  typedef typename PoolAVLTNode<T, Compare>::Index Index;
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+  /** @brief Create an empty AVLTree.
+   * @post is_empty()
+   */
+  PoolAVLTree (Compare const& comp=Compare()):
+      _root(null_index), current_(null_index), free_(null_index), size_(0), comp_(comp)
+  {
+      assert(is_empty());
+  }
+
+  /** @brief Destroy a AVLTree.**/
+  ~PoolAVLTree()
+  {}
+
+  /** @}*/
+
+  /** @name Observers*/
+
+  /** @{*/
+
+  /** @brief is the tree empty?.*/
+  bool is_empty () const
+  {
+      return _root == null_index;
+  }
+
+  /** @brief Get the number of keys.*/
+  size_t size() const
+  {
+      return size_;
+  }
+
+  /** @brief Get the root item.
+   * @pre not is_empty();
+   */
+  T const& item() const
+  {
+      assert(!is_empty());
+      return _nodes[_root].item;
+  }
+
+  /** @brief Is the cursor at a valid position?*/
+  bool current_exists() const
+  {
+      return current_ != null_index;
+  }
+
+  /**
+   * @brief Get the current key.
+   * @pre current_exists()
+   */
+  T const& current() const
+  {
+      assert(current_exists());
+      return _nodes[current_].item;
+  }
+
+  /** @brief Get the root node.*/
+  Ref root() const
+  {
+      return Ref(this, _root);
+  }
+
+  /** @brief Get the node at the cursor.*/
+  Ref current_node() const
+  {
+      return Ref(this, current_);
+  }
+
+  /** @brief Get the node with the first key (null if empty).*/
+  Ref first() const
+  {
+      return Ref(this, _root == null_index ? null_index : leftmost(_root));
+  }
+
+  /** @brief Get the node with the last key (null if empty).*/
+  Ref last() const
+  {
+      return Ref(this, _root == null_index ? null_index : rightmost(_root));
+  }
+
+  /** @brief Get the node with a key without moving the cursor.
+   * The key can be a T or any type that Compare compares with T.
+   * @return a null reference if the key is not found.
+   */
+  template <class Key>
+  Ref find(const Key& k) const
+  {
+      return Ref(this, find_index(k));
+  }
+
+  /** @brief Get the node with the first key not lesser than k.
+   * @return a null reference if there is not such key.
+   */
+  template <class Key>
+  Ref lower_bound(const Key& k) const
+  {
+      Index n = _root;
+      Index bound = null_index;
+      while (n != null_index)
+      {
+          if (comp_(_nodes[n].item, k))
+              n = _nodes[n].right;
+          else
+          {
+              bound = n;
+              n = _nodes[n].left;
+          }
+      }
+      return Ref(this, bound);
+  }
+
+  /** @brief Get the node with the first key greater than k.
+   * @return a null reference if there is not such key.
+   */
+  template <class Key>
+  Ref upper_bound(const Key& k) const
+  {
+      Index n = _root;
+      Index bound = null_index;
+      while (n != null_index)
+      {
+          if (comp_(k, _nodes[n].item))
+          {
+              bound = n;
+              n = _nodes[n].left;
+          }
+          else
+              n = _nodes[n].right;
+      }
+      return Ref(this, bound);
+  }
+
+  /** @brief Has the tree got this key */
+  bool has(const T& k) const
+  {
+      return find_index(k) != null_index;
+  }
+
+  /** @brief Get the tree height (-1 if empty).*/
+  int height() const
+  {
+      return node_height(_root);
+  }
+
+  /** @brief Get the key order.*/
+  Compare const& key_comp() const
+  {
+      return comp_;
+  }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+
+  /** @{*/
+
+  /** @brief Reserve room in the pool for n nodes.*/
+  void reserve(size_t n)
+  {
+      _nodes.reserve(n);
+  }
+
+  /**
+   * @brief Release all the nodes.
+   * @post is_empty()
+   * @post not current_exists()
+   */
+  void clear()
+  {
+      _nodes.clear();
+      _root = current_ = free_ = null_index;
+      size_ = 0;
+  }
+
+  /**
+   * @brief Search a key moving the cursor.
+   * @post retV implies current()==k
+   * @post not retv implies not current_exits()
+   */
+  bool search(T const& k)
+  {
+      current_ = find_index(k);
+      return current_exists();
+  }
+
+  /**
+   * @brief Insert a new key in the tree.
+   * @pre not has(k)
+   * @post current_exists()
+   * @post current()==k
+   */
+  void insert(T const& k)
+  {
+      assert(! has(k));
+
+      Index parent = null_index;
+      Index n = _root;
+      bool is_left = false;
+      while (n != null_index)
+      {
+          parent = n;
+          is_left = comp_(k, _nodes[n].item);
+          n = is_left ? _nodes[n].left : _nodes[n].right;
+      }
+      current_ = new_node(k, parent);
+      if (parent == null_index)
+          _root = current_;
+      else if (is_left)
+          _nodes[parent].left = current_;
+      else
+          _nodes[parent].right = current_;
+      ++size_;
+      make_balanced(parent);
+
+      //check invariants.
+      AVL_CHECK(is_a_binary_search_tree());
+      AVL_CHECK(is_a_balanced_tree());
+
+      //check postconditions.
+      assert(current_exists());
+      assert(!comp_(current(), k) && !comp_(k, current()));
+  }
+
+  /**
+   * @brief remove current from the tree.
+   * @pre current_exists()
+   * @post not current_exists()
+   */
+  void remove ()
+  {
+      assert(current_exists());
+
+      //A node with two children takes the key of its in order successor,
+      //which is removed instead.
+      Index z = current_;
+      if (_nodes[z].left != null_index && _nodes[z].right != null_index)
+      {
+          Index s = leftmost(_nodes[z].right);
+          _nodes[z].item = std::move(_nodes[s].item);
+          z = s;
+      }
+
+      //Now z has one child at most, which replaces it.
+      Index child = _nodes[z].left != null_index ? _nodes[z].left : _nodes[z].right;
+      Index parent = _nodes[z].parent;
+      if (child != null_index)
+          _nodes[child].parent = parent;
+      replace_child(parent, z, child);
+      free_node(z);
+      --size_;
+      current_ = null_index;
+      make_balanced(parent);
+
+      //check invariants.
+      AVL_CHECK(is_a_binary_search_tree());
+      AVL_CHECK(is_a_balanced_tree());
+
+      //check postconditions.
+      assert(! current_exists());
+  }
+
+  /** @}*/
+
+private:
+
+  /** @brief desactivate Copy constructor. */
+  PoolAVLTree(const PoolAVLTree<T, Compare>& other);
+
+  /** @brief desactivate assign operator. */
+  PoolAVLTree<T, Compare>& operator =(const PoolAVLTree<T, Compare>& other);
+
+  friend class PoolAVLTNode<T, Compare>;
+
+protected:
+
+  static const Index null_index = PoolAVLTNode<T, Compare>::null_index;
+
+  /** @brief The node storage.*/
+  struct Slot
+  {
+      T item;
+      Index parent;
+      Index left;
+      Index right; //next free slot when the slot is free.
+      int height;
+  };
+
+  Slot const& slot(Index i) const
+  {
+      return _nodes[i];
+  }
+
+  /** @brief Get a free slot (reusing the removed ones first).*/
+  Index new_node(T const& k, Index parent)
+  {
+      Index i = free_;
+      if (i != null_index)
+      {
+          free_ = _nodes[i].right;
+          _nodes[i].item = k;
+      }
+      else
+      {
+          assert(_nodes.size() < null_index);
+          i = static_cast<Index>(_nodes.size());
+          _nodes.push_back(Slot{k, null_index, null_index, null_index, 0});
+      }
+      Slot& s = _nodes[i];
+      s.parent = parent;
+      s.left = s.right = null_index;
+      s.height = 0;
+      return i;
+  }
+
+  /** @brief Put a slot into the free list.*/
+  void free_node(Index i)
+  {
+      _nodes[i].parent = _nodes[i].left = null_index;
+      _nodes[i].right = free_;
+      free_ = i;
+  }
+
+  int node_height(Index i) const
+  {
+      return i == null_index ? -1 : _nodes[i].height;
+  }
+
+  /** @brief Compute the node height from its children.*/
+  void update_height(Index i)
+  {
+      _nodes[i].height = 1 + std::max(node_height(_nodes[i].left),
+                                      node_height(_nodes[i].right));
+  }
+
+  /** @brief Compute the balance factor of the node.*/
+  int balance_factor(Index i) const
+  {
+      return node_height(_nodes[i].right) - node_height(_nodes[i].left);
+  }
+
+  Index leftmost(Index i) const
+  {
+      while (_nodes[i].left != null_index)
+          i = _nodes[i].left;
+      return i;
+  }
+
+  Index rightmost(Index i) const
+  {
+      while (_nodes[i].right != null_index)
+          i = _nodes[i].right;
+      return i;
+  }
+
+  Index successor(Index i) const
+  {
+      if (_nodes[i].right != null_index)
+          return leftmost(_nodes[i].right);
+      Index p = _nodes[i].parent;
+      while (p != null_index && _nodes[p].right == i)
+      {
+          i = p;
+          p = _nodes[p].parent;
+      }
+      return p;
+  }
+
+  Index predecessor(Index i) const
+  {
+      if (_nodes[i].left != null_index)
+          return rightmost(_nodes[i].left);
+      Index p = _nodes[i].parent;
+      while (p != null_index && _nodes[p].left == i)
+      {
+          i = p;
+          p = _nodes[p].parent;
+      }
+      return p;
+  }
+
+  template <class Key>
+  Index find_index(Key const& k) const
+  {
+      Index n = _root;
+      while (n != null_index)
+      {
+          if (comp_(k, _nodes[n].item))
+              n = _nodes[n].left;
+          else if (comp_(_nodes[n].item, k))
+              n = _nodes[n].right;
+          else
+              break;
+      }
+      return n;
+  }
+
+  /** @brief Replace the link from parent to child by new_child
+   * (the root link if there is not parent).
+   */
+  void replace_child(Index parent, Index child, Index new_child)
+  {
+      if (parent == null_index)
+          _root = new_child;
+      else if (_nodes[parent].left == child)
+          _nodes[parent].left = new_child;
+      else
+          _nodes[parent].right = new_child;
+  }
+
+  /**
+   * @brief make a left rotation of the subtree rooted at x.
+   * @return the new subtree root.
+   */
+  Index rotate_left(Index x)
+  {
+      Index y = _nodes[x].right;
+      Index b = _nodes[y].left;
+      _nodes[x].right = b;
+      if (b != null_index)
+          _nodes[b].parent = x;
+      _nodes[y].parent = _nodes[x].parent;
+      replace_child(_nodes[x].parent, x, y);
+      _nodes[y].left = x;
+      _nodes[x].parent = y;
+      update_height(x);
+      update_height(y);
+      return y;
+  }
+
+  /**
+   * @brief make a right rotation of the subtree rooted at x.
+   * @return the new subtree root.
+   */
+  Index rotate_right(Index x)
+  {
+      Index y = _nodes[x].left;
+      Index b = _nodes[y].right;
+      _nodes[x].left = b;
+      if (b != null_index)
+          _nodes[b].parent = x;
+      _nodes[y].parent = _nodes[x].parent;
+      replace_child(_nodes[x].parent, x, y);
+      _nodes[y].right = x;
+      _nodes[x].parent = y;
+      update_height(x);
+      update_height(y);
+      return y;
+  }
+
+  /**
+   * @brief Rebalance the tree from a node up to the root.
+   * The heights are updated locally and it stops as soon as a subtree
+   * keeps its height, because the ancestors do not change then.
+   */
+  void make_balanced(Index n)
+  {
+      while (n != null_index)
+      {
+          const int old_height = _nodes[n].height;
+          update_height(n);
+          const int bf = balance_factor(n);
+          if (bf < -1)
+          {
+              //left-right case needs a previous left rotation.
+              if (balance_factor(_nodes[n].left) > 0)
+                  rotate_left(_nodes[n].left);
+              n = rotate_right(n);
+          }
+          else if (bf > 1)
+          {
+              //right-left case needs a previous right rotation.
+              if (balance_factor(_nodes[n].right) < 0)
+                  rotate_right(_nodes[n].right);
+              n = rotate_left(n);
+          }
+          if (_nodes[n].height == old_height)
+              break;
+          n = _nodes[n].parent;
+      }
+  }
+
+  /** @brief Check the binary search tree invariant and the parent links.*/
+  bool is_a_binary_search_tree() const
+  {
+      if (_root != null_index && _nodes[_root].parent != null_index)
+          return false;
+      size_t count = 0;
+      Index prev = null_index;
+      for (Index n = _root == null_index ? null_index : leftmost(_root);
+           n != null_index; n = successor(n))
+      {
+          if (prev != null_index && !comp_(_nodes[prev].item, _nodes[n].item))
+              return false;
+          Index l = _nodes[n].left, r = _nodes[n].right;
+          if ((l != null_index && _nodes[l].parent != n) ||
+              (r != null_index && _nodes[r].parent != n))
+              return false;
+          prev = n;
+          ++count;
+      }
+      return count == size_;
+  }
+
+  /** @brief Check the heights and the balanced tree invariant.*/
+  bool is_a_balanced_tree() const
+  {
+      for (Index n = _root == null_index ? null_index : leftmost(_root);
+           n != null_index; n = successor(n))
+      {
+          const int bf = balance_factor(n);
+          if (bf < -1 || bf > 1 || _nodes[n].height !=
+              1 + std::max(node_height(_nodes[n].left), node_height(_nodes[n].right)))
+              return false;
+      }
+      return true;
+  }
+
+  std::vector<Slot> _nodes;
+  Index _root;
+  Index current_;
+  Index free_;  //first free slot.
+  size_t size_;
+  Compare comp_;
+};
+
+template<class T, class Compare>
+const typename PoolAVLTree<T, Compare>::Index PoolAVLTree<T, Compare>::null_index;
+
+/**  @brief Fold a pooled avl tree node.
+ * The output format is the same as fold_AVLTNode().
+*/
+template<class T, class Compare>
+std::ostream&
+fold_AVLTNode (std::ostream& out, PoolAVLTNode<T, Compare> const& node)
+{
+    out << '[';
+    if (node)
+    {
+        out << node->item() << " : ";
+        fold_AVLTNode(out, node->left());
+        out << " : ";
+        fold_AVLTNode(out, node->right());
+    }
+    out << ']';
+    return out;
+}
+
+/**  @brief Fold a pooled avl tree. */
+template<class T, class Compare>
+std::ostream&
+operator << ( std::ostream& out, PoolAVLTree<T, Compare> const& tree)
+{
+    fold_AVLTNode(out, tree.root());
+    return out;
+}
+
+#endif
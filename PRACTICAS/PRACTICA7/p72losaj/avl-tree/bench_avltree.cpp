@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "avltree.hpp"
+#include "bench_utils.hpp"
+
+/** @name Rotations counter.
+ * The trees without the rotations() observer report a negative count.
+ */
+/** @{*/
+
+template <class Tree>
+auto
+tree_rotations(Tree const& tree, int) -> decltype(static_cast<long long>(tree.rotations()))
+{
+    return static_cast<long long>(tree.rotations());
+}
+
+template <class Tree>
+long long
+tree_rotations(Tree const&, long)
+{
+    return -1;
+}
+
+/** @}*/
+
+/** @brief Get the tree's height (-1 if empty) with a level traversal.*/
+template <class Tree>
+int
+tree_height(Tree const& tree)
+{
+    typedef decltype(tree.root().get()) Node;
+    std::vector<Node> level;
+    if (tree.root() != nullptr)
+        level.push_back(tree.root().get());
+    int height = -1;
+    while (!level.empty())
+    {
+        ++height;
+        std::vector<Node> next;
+        for (size_t i = 0; i < level.size(); ++i)
+        {
+            if (level[i]->has_left())
+                next.push_back(level[i]->left().get());
+            if (level[i]->has_right())
+                next.push_back(level[i]->right().get());
+        }
+        level.swap(next);
+    }
+    return height;
+}
+
+/** @brief Measures of an insertion order.*/
+struct Measure
+{
+    double insert_ns_op;
+    double search_ns_op;
+    double remove_ns_op;
+    double insert_rotations_op;
+    double remove_rotations_op;
+    int height;
+};
+
+/** @brief Rotations per operation or -1 if they are not counted.*/
+static double
+per_op(long long before, long long after, size_t n)
+{
+    if (before < 0 || n == 0)
+        return -1.0;
+    return static_cast<double>(after - before) / n;
+}
+
+/**
+ * @brief Insert the keys in order, search them in random order and remove
+ * them in the insertion order.
+ */
+static Measure
+measure(std::vector<int> const& keys, std::vector<int> const& queries)
+{
+    const size_t n = keys.size();
+    Measure m;
+    AVLTree<int> tree;
+
+    long long rotations = tree_rotations(tree, 0);
+    double s = seconds([&]()
+    {
+        for (size_t i = 0; i < n; ++i)
+            tree.insert(keys[i]);
+    });
+    m.insert_ns_op = n ? 1e9 * s / n : 0.0;
+    m.insert_rotations_op = per_op(rotations, tree_rotations(tree, 0), n);
+    m.height = tree_height(tree);
+
+    s = seconds([&]()
+    {
+        size_t found = 0;
+        for (size_t i = 0; i < n; ++i)
+            found += tree.has(queries[i]);
+        sink() = found;
+    });
+    m.search_ns_op = n ? 1e9 * s / n : 0.0;
+
+    rotations = tree_rotations(tree, 0);
+    s = seconds([&]()
+    {
+        for (size_t i = 0; i < n; ++i)
+            if (tree.search(keys[i]))
+                tree.remove();
+    });
+    m.remove_ns_op = n ? 1e9 * s / n : 0.0;
+    m.remove_rotations_op = per_op(rotations, tree_rotations(tree, 0), n);
+    return m;
+}
+
+/** @brief Generate n distinct keys in an insertion order.
+ * The adversarial order inserts the lowest and the highest remaining keys
+ * alternately, so the insertions go down the longest paths and make many
+ * double rotations.
+ * @return false if the order is unknown.
+ */
+static bool
+make_keys(std::string const& order, size_t n, std::vector<int>& keys)
+{
+    keys.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = static_cast<int>(i);
+    if (order == "random")
+        std::shuffle(keys.begin(), keys.end(), std::mt19937_64(1));
+    else if (order == "adversarial")
+        for (size_t i = 0; i < n; ++i)
+            keys[i] = static_cast<int>(i % 2 == 0 ? i / 2 : n - 1 - i / 2);
+    else if (order != "sorted")
+        return false;
+    return true;
+}
+
+/** @brief Write a measure as a JSON object.*/
+static void
+write_json(std::ostream& out, const char* order, size_t n, Measure const& m)
+{
+    out << "  {\"order\": \"" << order << "\", \"n\": " << n
+#ifdef NDEBUG
+        << ", \"ndebug\": true"
+#else
+        << ", \"ndebug\": false"
+#endif
+#ifdef __AVL_DEBUG_CHECKS
+        << ", \"debug_checks\": true"
+#else
+        << ", \"debug_checks\": false"
+#endif
+        << ", \"insert_ns_op\": " << m.insert_ns_op
+        << ", \"search_ns_op\": " << m.search_ns_op
+        << ", \"remove_ns_op\": " << m.remove_ns_op;
+    if (m.insert_rotations_op >= 0.0)
+        out << ", \"insert_rotations_op\": " << m.insert_rotations_op
+            << ", \"remove_rotations_op\": " << m.remove_rotations_op;
+    else
+        out << ", \"insert_rotations_op\": null, \"remove_rotations_op\": null";
+    out << ", \"height\": " << m.height << "}";
+}
+
+/**
+ * @brief Are the O(n) invariant checks run on each operation?
+ * They are the asserts when the tree has not AVL_CHECK, or AVL_CHECK with
+ * __AVL_DEBUG_CHECKS.
+ */
+#if !defined(NDEBUG) && (!defined(AVL_CHECK) || defined(__AVL_DEBUG_CHECKS))
+#define BENCH_AVL_SLOW_CHECKS 1
+#else
+#define BENCH_AVL_SLOW_CHECKS 0
+#endif
+
+/** @brief Benchmark the AVLTree operations.
+ * Usage: bench_avltree [n[,n...]]
+ * The default n is 1e3 in all the builds, so their outputs can be compared.
+ * The invariant checks make each operation O(n) (a warning is printed to
+ * stderr), so only the release build should be run with a larger n.
+ * The output is a JSON array with an object for each insertion order and
+ * n: ns per insert/search/remove, rotations per insert/remove, the height
+ * after the insertions and the build flags.
+ */
+int
+main(int argc, char* argv[])
+{
+    std::vector<size_t> sizes;
+    bool ok = argc <= 2;
+    if (ok && argc > 1)
+        ok = parse_list(argv[1], sizes);
+    else
+        sizes.push_back(1000);
+    if (!ok)
+    {
+        std::cerr << "Usage: " << argv[0] << " [n[,n...]]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (BENCH_AVL_SLOW_CHECKS)
+        std::cerr << "Warning: the invariant checks make each operation O(n),"
+                  << " so the times are not the AVLTree ones." << std::endl;
+
+    const char* orders[] = {"random", "sorted", "adversarial"};
+    std::vector<int> keys;
+    bool first = true;
+    std::cout << "[" << std::endl;
+    for (size_t s = 0; s < sizes.size(); ++s)
+        for (size_t o = 0; o < 3; ++o)
+        {
+            make_keys(orders[o], sizes[s], keys);
+            std::vector<int> queries(keys);
+            std::shuffle(queries.begin(), queries.end(), std::mt19937_64(2));
+            Measure m = measure(keys, queries);
+            if (!first)
+                std::cout << "," << std::endl;
+            first = false;
+            write_json(std::cout, orders[o], sizes[s], m);
+        }
+    std::cout << std::endl << "]" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "avltree.hpp"
+#include "bplustree.hpp"
+#include "bench_utils.hpp"
+
+/** @name Containers.
+ * They give the same has/insert/remove interface to the benchmarks.
+ */
+/** @{*/
+
+template <class K>
+struct AVLTreeBench
+{
+    static const char* name()
+    {
+        return "avltree";
+    }
+
+    bool has(K const& k) const
+    {
+        return tree.has(k);
+    }
+
+    void insert(K const& k)
+    {
+        tree.insert(k);
+    }
+
+    void remove(K const& k)
+    {
+        if (tree.search(k))
+            tree.remove();
+    }
+
+    AVLTree<K> tree;
+};
+
+template <class K>
+struct BPlusTreeBench
+{
+    static const char* name()
+    {
+        return "bplustree";
+    }
+
+    bool has(K const& k) const
+    {
+        return tree.has(k);
+    }
+
+    void insert(K const& k)
+    {
+        tree.insert(k);
+    }
+
+    void remove(K const& k)
+    {
+        if (tree.search(k))
+            tree.remove();
+    }
+
+    BPlusTree<K> tree;
+};
+
+template <class K>
+struct StdSetBench
+{
+    static const char* name()
+    {
+        return "std::set";
+    }
+
+    bool has(K const& k) const
+    {
+        return tree.count(k) != 0;
+    }
+
+    void insert(K const& k)
+    {
+        tree.insert(k);
+    }
+
+    void remove(K const& k)
+    {
+        tree.erase(k);
+    }
+
+    std::set<K> tree;
+};
+
+/** @}*/
+
+static void
+write_row(const char* workload, const char* container, const char* type,
+          size_t n, double s)
+{
+    std::cout << workload << '\t' << container << '\t' << type << '\t' << n
+              << '\t' << (n ? 1e9 * s / n : 0.0) << std::endl;
+}
+
+/**
+ * @brief Run the workloads on a container.
+ * The keys are inserted, searched in other random order, and removed.
+ */
+template <class Bench, class K>
+void
+bench_container(std::vector<K> const& keys, std::vector<K> const& queries,
+                const char* type)
+{
+    const size_t n = keys.size();
+    Bench* bench = new Bench();
+    write_row("insert", Bench::name(), type, n, seconds([&]()
+    {
+        for (size_t i = 0; i < n; ++i)
+            bench->insert(keys[i]);
+    }));
+    write_row("search", Bench::name(), type, n, seconds([&]()
+    {
+        size_t found = 0;
+        for (size_t i = 0; i < n; ++i)
+            found += bench->has(queries[i]);
+        sink() = found;
+    }));
+    write_row("remove", Bench::name(), type, n, seconds([&]()
+    {
+        for (size_t i = 0; i < n; ++i)
+            bench->remove(queries[i]);
+    }));
+    delete bench;
+}
+
+/** @brief Run all the containers for a key type.*/
+template <class K>
+void
+bench_keys(std::vector<K> const& keys, const char* type)
+{
+    std::vector<K> queries(keys);
+    std::shuffle(queries.begin(), queries.end(), std::mt19937_64(2));
+    bench_container<AVLTreeBench<K>>(keys, queries, type);
+    bench_container<BPlusTreeBench<K>>(keys, queries, type);
+    bench_container<StdSetBench<K>>(keys, queries, type);
+}
+
+/** @brief Benchmark the B+ tree against the AVL tree and std::set.
+ * Usage: bench_btree [n[,n...]]
+ * The default n is 1e7 distinct random keys, as int and as 16 chars
+ * strings. The output is a table with the ns per operation for each
+ * workload, container and key type.
+ */
+int
+main(int argc, char* argv[])
+{
+    std::vector<size_t> sizes;
+    bool ok = argc <= 2;
+    if (ok && argc > 1)
+        ok = parse_list(argv[1], sizes);
+    else
+        sizes.push_back(10000000);
+    if (!ok)
+    {
+        std::cerr << "Usage: " << argv[0] << " [n[,n...]]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "workload\tcontainer\ttype\tn\tns_op" << std::endl;
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        //Distinct keys: a permutation of an arithmetic progression.
+        std::vector<int> keys(sizes[s]);
+        for (size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i * 7 + 3);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937_64(1));
+        bench_keys(keys, "int");
+
+        std::vector<std::string> str_keys(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            std::string digits = std::to_string(keys[i]);
+            str_keys[i] = "key-" + std::string(12 - std::min<size_t>(12, digits.size()), '0') + digits;
+        }
+        keys = std::vector<int>();
+        bench_keys(str_keys, "string");
+    }
+    return EXIT_SUCCESS;
+}
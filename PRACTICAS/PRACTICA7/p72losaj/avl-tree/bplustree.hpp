@@ -0,0 +1,661 @@
+#ifndef __ED_BPlusTree_HPP__
+#define __ED_BPlusTree_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "avltree.hpp"
+
+/** @brief Size of a cache line in bytes.*/
+static const size_t BPLUS_CACHE_LINE = 64;
+
+/**
+ * @brief Allocate a block of size bytes aligned to align (a power of two).
+ * In C++11 new only aligns to alignof(std::max_align_t), so the block is
+ * over allocated and the address to release is kept before the aligned one.
+ */
+inline void*
+bplus_aligned_alloc(size_t size, size_t align)
+{
+    void* block = ::operator new(size + align + sizeof(void*));
+    std::uintptr_t p = reinterpret_cast<std::uintptr_t>(block) + sizeof(void*);
+    p = (p + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+    reinterpret_cast<void**>(p)[-1] = block;
+    return reinterpret_cast<void*>(p);
+}
+
+/** @brief Release a block allocated with bplus_aligned_alloc().*/
+inline void
+bplus_aligned_free(void* p)
+{
+    if (p != nullptr)
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+}
+
+/**
+ * @name Intra node search.
+ * Get the number of keys of a sorted node for which before(key) is true.
+ */
+/** @{*/
+
+/**
+ * @brief Count the keys with a linear scan.
+ * It is a plain loop without branches: there are not SIMD intrinsics, it
+ * relies on the compiler auto-vectorization for the arithmetic types (i.e.
+ * g++ -O3 compares four int keys per SSE2 instruction). A node only spans
+ * a few cache lines, so this is faster than a binary search.
+ */
+template<class T, class Before>
+inline size_t
+bplus_count_before(T const* keys, size_t n, Before const& before, std::true_type)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+        count += before(keys[i]) ? 1 : 0;
+    return count;
+}
+
+/**
+ * @brief Count the keys with a binary search.
+ * The loop halves the range with a conditional move instead of a branch,
+ * so there are not branch mispredictions.
+ */
+template<class T, class Before>
+inline size_t
+bplus_count_before(T const* keys, size_t n, Before const& before, std::false_type)
+{
+    if (n == 0)
+        return 0;
+    T const* base = keys;
+    while (n > 1)
+    {
+        const size_t half = n / 2;
+        base = before(base[half]) ? base + half : base;
+        n -= half;
+    }
+    return (base - keys) + (before(*base) ? 1 : 0);
+}
+
+/** @}*/
+
+/**
+ * @brief ADT BPlusTree.
+ * Models a B+ tree of T with the same interface of AVLTree<T>.
+ *
+ * The keys are stored into the leaves, which are linked in order, and the
+ * inner nodes only keep separators. The nodes are aligned to a cache line
+ * and span NodeLines cache lines (if sizeof(T) allows at least four keys),
+ * so each level is a few contiguous cache lines instead of a pointer per
+ * key and the tree is very shallow.
+ *
+ * The cursor is a (leaf, position) pair.
+ */
+template<class T, size_t NodeLines = 4>
+class BPlusTree
+{
+  public:
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+    /** @brief Create an empty BPlusTree.
+     * @post is_empty()
+     */
+    BPlusTree ():
+        _root(nullptr), current_(nullptr), current_pos_(0), size_(0), height_(0)
+    {}
+
+    /** @brief Destroy a BPlusTree.**/
+    ~BPlusTree()
+    {
+        clear();
+    }
+
+  /** @}*/
+
+  /** @name Observers*/
+  /** @{*/
+
+    /** @brief is the tree empty?.*/
+    bool is_empty () const
+    {
+        return size_ == 0;
+    }
+
+    /** @brief Get the number of keys.*/
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /** @brief Get the number of levels.*/
+    size_t height() const
+    {
+        return height_;
+    }
+
+    /** @brief Is the cursor at a valid position?*/
+    bool current_exists() const
+    {
+        return current_ != nullptr;
+    }
+
+    /**
+     * @brief Get the current key.
+     * @pre current_exists()
+     */
+    T const& current() const
+    {
+        assert(current_exists());
+        return current_->keys[current_pos_];
+    }
+
+    /** @brief Has the tree got this key */
+    bool has(const T& k) const
+    {
+        AVL_CHECK(is_a_valid_tree());
+        if (_root == nullptr)
+            return false;
+        Leaf const* leaf = find_leaf(k);
+        size_t pos = lower_index(leaf, k);
+        return pos < leaf->count && !(k < leaf->keys[pos]);
+    }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+  /** @{*/
+
+    /**
+     * @brief Remove all the keys.
+     * @post is_empty()
+     * @post not current_exists()
+     */
+    void clear()
+    {
+        if (_root != nullptr)
+            destroy(_root, height_);
+        _root = nullptr;
+        current_ = nullptr;
+        size_ = 0;
+        height_ = 0;
+    }
+
+    /**
+     * @brief Search a key moving the cursor.
+     * @post retV implies current()==k
+     * @post not retv implies not current_exits()
+     */
+    bool search(T const& k)
+    {
+        AVL_CHECK(is_a_valid_tree());
+        current_ = nullptr;
+        if (_root != nullptr)
+        {
+            Leaf* leaf = find_leaf(k);
+            size_t pos = lower_index(leaf, k);
+            if (pos < leaf->count && !(k < leaf->keys[pos]))
+            {
+                current_ = leaf;
+                current_pos_ = pos;
+            }
+        }
+        assert(!current_exists() || current()==k);
+        return current_exists();
+    }
+
+    /**
+     * @brief Insert a new key in the tree.
+     * A full node is split in two halves and the separator goes up to the
+     * parent, so the tree grows from the root.
+     * @pre not has(k)
+     * @post current_exists()
+     * @post current()==k
+     */
+    void insert(T const& k)
+    {
+        assert(! has(k));
+
+        if (_root == nullptr)
+        {
+            _root = new Leaf();
+            height_ = 1;
+        }
+        Leaf* leaf = find_path(k);
+        size_t pos = lower_index(leaf, k);
+        insert_at(leaf->keys, leaf->count, pos, k);
+        ++leaf->count;
+        ++size_;
+        current_ = leaf;
+        current_pos_ = pos;
+
+        if (leaf->count > LEAF_CAPACITY)
+            split_leaf(leaf);
+
+        AVL_CHECK(is_a_valid_tree());
+        assert(current_exists());
+        assert(current()==k);
+    }
+
+    /**
+     * @brief remove current from the tree.
+     * A node with less than the half of its capacity borrows a key from
+     * a sibling or it is merged with it.
+     * @pre current_exists()
+     * @post not current_exists()
+     */
+    void remove ()
+    {
+        assert(current_exists());
+
+        Leaf* leaf = current_;
+        const size_t pos = current_pos_;
+        //The path is needed to fix the underflows.
+        find_path(leaf->keys[pos]);
+        erase_at(leaf->keys, leaf->count, pos);
+        --leaf->count;
+        --size_;
+        current_ = nullptr;
+
+        if (path_.empty())
+        {
+            if (leaf->count == 0)
+                clear();
+        }
+        else if (leaf->count < LEAF_CAPACITY / 2)
+            fix_leaf_underflow(leaf);
+
+        AVL_CHECK(is_a_valid_tree());
+        assert(! current_exists());
+    }
+
+  /** @}*/
+
+private:
+
+  /** @brief desactivate Copy constructor. */
+  BPlusTree(const BPlusTree<T, NodeLines>& other);
+
+  /** @brief desactivate assign operator. */
+  BPlusTree<T, NodeLines>& operator =(const BPlusTree<T, NodeLines>& other);
+
+protected:
+
+    /** @brief Bytes of a node without its header.*/
+    static const size_t NODE_BYTES = NodeLines * BPLUS_CACHE_LINE - 2 * sizeof(void*);
+
+    /** @brief Maximum number of keys of a leaf.
+     * The spare key used by the splits is in the node bytes too.
+     */
+    static const size_t LEAF_CAPACITY =
+        NODE_BYTES / sizeof(T) > 5 ? NODE_BYTES / sizeof(T) - 1 : 4;
+
+    /** @brief Maximum number of separators of an inner node.
+     * The spare separator and the two spare children are in the node
+     * bytes too.
+     */
+    static const size_t INNER_CAPACITY =
+        (NODE_BYTES - sizeof(void*)) / (sizeof(T) + sizeof(void*)) > 5 ?
+            (NODE_BYTES - sizeof(void*)) / (sizeof(T) + sizeof(void*)) - 1 : 4;
+
+    /** @brief Common part of the nodes.
+     * The nodes are aligned to a cache line. The class operator new is
+     * needed because the new of C++11 ignores the over alignment.
+     */
+    struct alignas(BPLUS_CACHE_LINE) Node
+    {
+        size_t count = 0;
+
+        static void* operator new(size_t size)
+        {
+            return bplus_aligned_alloc(size, BPLUS_CACHE_LINE);
+        }
+
+        static void operator delete(void* p)
+        {
+            bplus_aligned_free(p);
+        }
+    };
+
+    /** @brief A leaf keeps the keys.
+     * It has room for one more key, so a full leaf is split after the
+     * insertion.
+     */
+    struct Leaf: public Node
+    {
+        T keys[LEAF_CAPACITY + 1];
+        Leaf* next = nullptr;
+    };
+
+    /** @brief An inner node keeps count separators and count+1 children.
+     * The keys of children[i] are in [keys[i-1], keys[i]).
+     */
+    struct Inner: public Node
+    {
+        T keys[INNER_CAPACITY + 1];
+        Node* children[INNER_CAPACITY + 2];
+    };
+
+    /** @brief A step of the path from the root to a leaf.*/
+    struct Step
+    {
+        Inner* node;
+        size_t child;
+    };
+
+    typedef std::integral_constant<bool, std::is_arithmetic<T>::value> LinearSearch;
+
+    /** @brief Get the position of the first key not lesser than k.*/
+    static size_t lower_index(Leaf const* leaf, T const& k)
+    {
+        return bplus_count_before(leaf->keys, leaf->count,
+                                  [&k](T const& key) {return key < k;},
+                                  LinearSearch());
+    }
+
+    /** @brief Get the child whose subtree can have k.*/
+    static size_t child_index(Inner const* inner, T const& k)
+    {
+        return bplus_count_before(inner->keys, inner->count,
+                                  [&k](T const& key) {return !(k < key);},
+                                  LinearSearch());
+    }
+
+    /** @brief Get the leaf that can have k.
+     * @pre not is_empty()
+     */
+    Leaf* find_leaf(T const& k) const
+    {
+        Node* n = _root;
+        for (size_t level = 1; level < height_; ++level)
+        {
+            Inner* inner = static_cast<Inner*>(n);
+            n = inner->children[child_index(inner, k)];
+        }
+        return static_cast<Leaf*>(n);
+    }
+
+    /** @brief Get the leaf that can have k saving the path into path_.
+     * @pre not is_empty()
+     */
+    Leaf* find_path(T const& k)
+    {
+        path_.clear();
+        Node* n = _root;
+        for (size_t level = 1; level < height_; ++level)
+        {
+            Inner* inner = static_cast<Inner*>(n);
+            Step step = {inner, child_index(inner, k)};
+            path_.push_back(step);
+            n = inner->children[step.child];
+        }
+        return static_cast<Leaf*>(n);
+    }
+
+    template <class U>
+    static void insert_at(U* values, size_t n, size_t pos, U const& v)
+    {
+        std::move_backward(values + pos, values + n, values + n + 1);
+        values[pos] = v;
+    }
+
+    template <class U>
+    static void erase_at(U* values, size_t n, size_t pos)
+    {
+        std::move(values + pos + 1, values + n, values + pos);
+    }
+
+    /** @brief Split an overflowed leaf and insert the separator into the parent.*/
+    void split_leaf(Leaf* leaf)
+    {
+        Leaf* right = new Leaf();
+        const size_t half = leaf->count / 2;
+        right->count = leaf->count - half;
+        std::move(leaf->keys + half, leaf->keys + leaf->count, right->keys);
+        leaf->count = half;
+        right->next = leaf->next;
+        leaf->next = right;
+        if (current_pos_ >= half)
+        {
+            current_ = right;
+            current_pos_ -= half;
+        }
+        insert_separator(right->keys[0], right);
+    }
+
+    /** @brief Insert a separator and its right child into the last parent
+     * of path_, splitting the overflowed inner nodes.
+     */
+    void insert_separator(T sep, Node* right)
+    {
+        while (!path_.empty())
+        {
+            Step step = path_.back();
+            path_.pop_back();
+            Inner* inner = step.node;
+            insert_at(inner->keys, inner->count, step.child, sep);
+            insert_at(inner->children, inner->count + 1, step.child + 1, right);
+            ++inner->count;
+            if (inner->count <= INNER_CAPACITY)
+                return;
+
+            //Split: the middle separator goes up.
+            Inner* sibling = new Inner();
+            const size_t mid = inner->count / 2;
+            sibling->count = inner->count - mid - 1;
+            std::move(inner->keys + mid + 1, inner->keys + inner->count, sibling->keys);
+            std::copy(inner->children + mid + 1, inner->children + inner->count + 1,
+                      sibling->children);
+            sep = inner->keys[mid];
+            inner->count = mid;
+            right = sibling;
+        }
+
+        //The root was split, so a new root is added.
+        Inner* new_root = new Inner();
+        new_root->count = 1;
+        new_root->keys[0] = sep;
+        new_root->children[0] = _root;
+        new_root->children[1] = right;
+        _root = new_root;
+        ++height_;
+    }
+
+    /** @brief Borrow a key from a sibling or merge with it.
+     * @pre not path_.empty()
+     */
+    void fix_leaf_underflow(Leaf* leaf)
+    {
+        Step step = path_.back();
+        Inner* parent = step.node;
+        const size_t i = step.child;
+        Leaf* left = i > 0 ? static_cast<Leaf*>(parent->children[i-1]) : nullptr;
+        Leaf* right = i < parent->count ? static_cast<Leaf*>(parent->children[i+1]) : nullptr;
+
+        if (left != nullptr && left->count > LEAF_CAPACITY / 2)
+        {
+            insert_at(leaf->keys, leaf->count, 0, left->keys[left->count-1]);
+            ++leaf->count;
+            --left->count;
+            parent->keys[i-1] = leaf->keys[0];
+        }
+        else if (right != nullptr && right->count > LEAF_CAPACITY / 2)
+        {
+            leaf->keys[leaf->count++] = right->keys[0];
+            erase_at(right->keys, right->count, 0);
+            --right->count;
+            parent->keys[i] = right->keys[0];
+        }
+        else
+        {
+            //Merge the leaf at position j with its right sibling.
+            const size_t j = left != nullptr ? i-1 : i;
+            Leaf* a = static_cast<Leaf*>(parent->children[j]);
+            Leaf* b = static_cast<Leaf*>(parent->children[j+1]);
+            std::move(b->keys, b->keys + b->count, a->keys + a->count);
+            a->count += b->count;
+            a->next = b->next;
+            delete b;
+            remove_separator(j);
+        }
+    }
+
+    /**
+     * @brief Remove the separator j and the child j+1 from the last parent
+     * of path_, fixing the underflowed inner nodes.
+     */
+    void remove_separator(size_t j)
+    {
+        Inner* inner = path_.back().node;
+        path_.pop_back();
+        erase_at(inner->keys, inner->count, j);
+        erase_at(inner->children, inner->count + 1, j + 1);
+        --inner->count;
+
+        if (path_.empty())
+        {
+            //The root keeps at least one separator.
+            if (inner->count == 0)
+            {
+                _root = inner->children[0];
+                delete inner;
+                --height_;
+            }
+            return;
+        }
+        if (inner->count >= INNER_CAPACITY / 2)
+            return;
+
+        Step step = path_.back();
+        Inner* parent = step.node;
+        const size_t i = step.child;
+        Inner* left = i > 0 ? static_cast<Inner*>(parent->children[i-1]) : nullptr;
+        Inner* right = i < parent->count ? static_cast<Inner*>(parent->children[i+1]) : nullptr;
+
+        if (left != nullptr && left->count > INNER_CAPACITY / 2)
+        {
+            //Rotate the last separator of left through the parent.
+            insert_at(inner->keys, inner->count, 0, parent->keys[i-1]);
+            insert_at(inner->children, inner->count + 1, 0, left->children[left->count]);
+            ++inner->count;
+            parent->keys[i-1] = left->keys[left->count-1];
+            --left->count;
+        }
+        else if (right != nullptr && right->count > INNER_CAPACITY / 2)
+        {
+            //Rotate the first separator of right through the parent.
+            inner->keys[inner->count] = parent->keys[i];
+            inner->children[inner->count + 1] = right->children[0];
+            ++inner->count;
+            parent->keys[i] = right->keys[0];
+            erase_at(right->keys, right->count, 0);
+            erase_at(right->children, right->count + 1, 0);
+            --right->count;
+        }
+        else
+        {
+            //Merge the node at position j with its right sibling.
+            const size_t m = left != nullptr ? i-1 : i;
+            Inner* a = static_cast<Inner*>(parent->children[m]);
+            Inner* b = static_cast<Inner*>(parent->children[m+1]);
+            a->keys[a->count] = parent->keys[m];
+            std::move(b->keys, b->keys + b->count, a->keys + a->count + 1);
+            std::copy(b->children, b->children + b->count + 1, a->children + a->count + 1);
+            a->count += b->count + 1;
+            delete b;
+            remove_separator(m);
+        }
+    }
+
+    /** @brief Free a subtree with levels levels.*/
+    static void destroy(Node* n, size_t levels)
+    {
+        if (levels == 1)
+        {
+            delete static_cast<Leaf*>(n);
+            return;
+        }
+        Inner* inner = static_cast<Inner*>(n);
+        for (size_t i = 0; i <= inner->count; ++i)
+            destroy(inner->children[i], levels - 1);
+        delete inner;
+    }
+
+    /**
+     * @brief Check the B+ tree invariant.
+     * The leaves are at the same level, the nodes (but the root) are at
+     * least half full, the keys are sorted and bounded by the separators
+     * and the leaves chain has all the keys in order.
+     */
+    bool is_a_valid_tree() const
+    {
+        if (_root == nullptr)
+            return size_ == 0 && height_ == 0;
+        size_t n_keys = 0;
+        Leaf const* first = nullptr;
+        if (!is_a_valid_subtree(_root, height_, nullptr, nullptr, n_keys, first))
+            return false;
+        if (n_keys != size_)
+            return false;
+        size_t n_chain = 0;
+        for (Leaf const* l = first; l != nullptr; l = l->next)
+        {
+            if (l->next != nullptr && l->count > 0 && l->next->count > 0 &&
+                !(l->keys[l->count-1] < l->next->keys[0]))
+                return false;
+            n_chain += l->count;
+        }
+        return n_chain == size_;
+    }
+
+    bool is_a_valid_subtree(Node const* n, size_t levels, T const* lo, T const* hi,
+                            size_t& n_keys, Leaf const*& first) const
+    {
+        const bool is_root = n == _root;
+        if (levels == 1)
+        {
+            Leaf const* leaf = static_cast<Leaf const*>(n);
+            if (first == nullptr)
+                first = leaf;
+            if (leaf->count > LEAF_CAPACITY || (!is_root && leaf->count < LEAF_CAPACITY / 2))
+                return false;
+            for (size_t i = 0; i < leaf->count; ++i)
+            {
+                if (i > 0 && !(leaf->keys[i-1] < leaf->keys[i]))
+                    return false;
+                if ((lo != nullptr && leaf->keys[i] < *lo) ||
+                    (hi != nullptr && !(leaf->keys[i] < *hi)))
+                    return false;
+            }
+            n_keys += leaf->count;
+            return true;
+        }
+        Inner const* inner = static_cast<Inner const*>(n);
+        if (inner->count > INNER_CAPACITY || inner->count == 0 ||
+            (!is_root && inner->count < INNER_CAPACITY / 2))
+            return false;
+        for (size_t i = 0; i <= inner->count; ++i)
+        {
+            T const* c_lo = i > 0 ? &inner->keys[i-1] : lo;
+            T const* c_hi = i < inner->count ? &inner->keys[i] : hi;
+            if (!is_a_valid_subtree(inner->children[i], levels - 1, c_lo, c_hi, n_keys, first))
+                return false;
+        }
+        return true;
+    }
+
+    Node* _root;
+    Leaf* current_;
+    size_t current_pos_;
+    size_t size_;
+    size_t height_;
+    std::vector<Step> path_; //path from the root to the last leaf found.
+};
+
+#endif
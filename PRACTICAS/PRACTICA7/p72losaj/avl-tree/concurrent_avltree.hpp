@@ -0,0 +1,391 @@
+#ifndef __ED_ConcurrentAVLTree_HPP__
+#define __ED_ConcurrentAVLTree_HPP__
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "avltree.hpp"
+
+/**
+ * @brief an immutable node of a ConcurrentAVLTree.
+ * A node is never changed after it is created, so it can be shared by
+ * several versions of the tree and read without locks. It has not parent
+ * link because a node can have several parents (one for each version).
+ */
+template <class T>
+class PersistentAVLTNode
+{
+public:
+
+    /** @brief Define a shared reference to a PersistentAVLTNode.*/
+    typedef std::shared_ptr< const PersistentAVLTNode<T> > Ref;
+
+    /** @name Life cicle.*/
+    /** @{*/
+
+    /** @brief Create a node with its children.
+     * The height and the size are computed from the children.
+     */
+    PersistentAVLTNode (Ref const& left, T const& it, Ref const& right):
+        _item(it), left_(left), right_(right)
+    {
+        int l_h = left_ ? left_->height() : -1;
+        int r_h = right_ ? right_->height() : -1;
+        height_ = 1 + (l_h > r_h ? l_h : r_h);
+        size_ = 1 + (left_ ? left_->size() : 0) + (right_ ? right_->size() : 0);
+    }
+
+    /** @}*/
+
+    /** @name Observers.*/
+    /** @{*/
+
+    /** @brief Get the data item.*/
+    const T& item() const
+    {
+        return _item;
+    }
+
+    /** @brief Get the node's height.*/
+    int height() const
+    {
+        return height_;
+    }
+
+    /** @brief Get the number of nodes of the subtree.*/
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /** @brief get the left child.*/
+    Ref const& left() const
+    {
+        return left_;
+    }
+
+    /** @brief get the right child.*/
+    Ref const& right() const
+    {
+        return right_;
+    }
+
+    /** @}*/
+
+protected:
+    T _item;
+    Ref left_;
+    Ref right_;
+    int height_;
+    size_t size_;
+};
+
+/**
+ * @brief a consistent read only version of a ConcurrentAVLTree.
+ * The snapshot keeps its version alive, so it does not see the later
+ * updates and it can be read while the writer goes on.
+ */
+template <class T>
+class AVLTreeSnapshot
+{
+public:
+
+    typedef typename PersistentAVLTNode<T>::Ref Ref;
+
+    /** @brief Create a snapshot of a version.*/
+    AVLTreeSnapshot (Ref const& root=nullptr): _root(root)
+    {}
+
+    /** @brief is the snapshot empty?*/
+    bool is_empty() const
+    {
+        return _root==nullptr;
+    }
+
+    /** @brief Get the number of keys.*/
+    size_t size() const
+    {
+        return _root==nullptr ? 0 : _root->size();
+    }
+
+    /** @brief Get the tree's height (-1 if empty).*/
+    int height() const
+    {
+        return _root==nullptr ? -1 : _root->height();
+    }
+
+    /** @brief Get the root node.*/
+    Ref const& root() const
+    {
+        return _root;
+    }
+
+    /** @brief Has the snapshot got this key?*/
+    bool has(T const& k) const
+    {
+        return find(k)!=nullptr;
+    }
+
+    /**
+     * @brief Find a key.
+     * @return the stored key or nullptr if the key is not found. It is valid
+     * while the snapshot lives.
+     */
+    T const* find(T const& k) const
+    {
+        PersistentAVLTNode<T> const* cursor=_root.get();
+        while(cursor!=nullptr)
+        {
+          if(k<cursor->item())
+            cursor=cursor->left().get();
+          else if(cursor->item()<k)
+            cursor=cursor->right().get();
+          else
+            return &cursor->item();
+        }
+        return nullptr;
+    }
+
+protected:
+    Ref _root;
+};
+
+/**
+ * @brief ADT ConcurrentAVLTree.
+ * Models a AVLTree of T that many threads can read while one thread writes.
+ *
+ * The updates copy the search path (O(log n) new nodes) and the other
+ * nodes are shared with the previous version, so a version is never
+ * changed. The root of the last version is published with an atomic store
+ * and the readers get it with an atomic load, so they always see a
+ * complete and balanced tree without waiting for the writer.
+ *
+ * The old versions are freed by the shared references when their last
+ * snapshot is destroyed.
+ *
+ * The atomic load of a shared_ptr is not lock free: it takes a lock of a
+ * small pool kept by the library and updates the reference counter. So the
+ * tree has no per call lookups: a reader takes a snapshot() and does all
+ * its lookups on it, taking a new one when it must see the later updates.
+ *
+ * The writers are serialized with a mutex.
+ */
+template<class T>
+class ConcurrentAVLTree
+{
+  public:
+
+    typedef typename PersistentAVLTNode<T>::Ref Ref;
+    typedef AVLTreeSnapshot<T> Snapshot;
+
+  /** @name Life cicle.*/
+  /** @{*/
+
+    /** @brief Create an empty ConcurrentAVLTree.
+     * @post snapshot().is_empty()
+     */
+    ConcurrentAVLTree ()
+    {}
+
+  /** @}*/
+
+  /** @name Observers*/
+  /** @{*/
+
+    /** @brief Get a snapshot of the last version.
+     * It is the only way to read the tree: keep the snapshot and reuse it
+     * for many lookups.
+     */
+    Snapshot snapshot() const
+    {
+        return Snapshot(std::atomic_load(&_root));
+    }
+
+  /** @}*/
+
+  /** @name Modifiers*/
+  /** @{*/
+
+    /**
+     * @brief Insert a new key in the tree.
+     * @return false if the key was already in the tree.
+     * @post snapshot().has(k)
+     */
+    bool insert(T const& k)
+    {
+        std::lock_guard<std::mutex> lock(writer_);
+        bool inserted = true;
+        Ref new_root = insert_subtree(std::atomic_load(&_root), k, inserted);
+        if (inserted)
+            publish(new_root);
+        return inserted;
+    }
+
+    /**
+     * @brief Remove a key from the tree.
+     * @return false if the key was not in the tree.
+     * @post not snapshot().has(k)
+     */
+    bool remove(T const& k)
+    {
+        std::lock_guard<std::mutex> lock(writer_);
+        bool removed = false;
+        Ref new_root = remove_subtree(std::atomic_load(&_root), k, removed);
+        if (removed)
+            publish(new_root);
+        return removed;
+    }
+
+  /** @}*/
+
+private:
+
+  /** @brief desactivate Copy constructor. */
+  ConcurrentAVLTree(const ConcurrentAVLTree<T>& other);
+
+  /** @brief desactivate assign operator. */
+  ConcurrentAVLTree<T>& operator =(const ConcurrentAVLTree<T>& other);
+
+protected:
+
+    /** @brief Publish a new version.*/
+    void publish(Ref const& new_root)
+    {
+        AVL_CHECK(is_a_valid_subtree(new_root.get()));
+        std::atomic_store(&_root, new_root);
+    }
+
+    static int subtree_height(Ref const& n)
+    {
+        return n==nullptr ? -1 : n->height();
+    }
+
+    static Ref make_node(Ref const& l, T const& item, Ref const& r)
+    {
+        return std::make_shared<const PersistentAVLTNode<T>>(l, item, r);
+    }
+
+    /**
+     * @brief Create a balanced node from two subtrees whose heights differ
+     * at most by two.
+     * The rotations are done creating new nodes.
+     */
+    static Ref make_balanced(Ref const& l, T const& item, Ref const& r)
+    {
+        const int h_l = subtree_height(l);
+        const int h_r = subtree_height(r);
+        if (h_l > h_r+1)
+        {
+            //The subtree is left un-balanced.
+            if (subtree_height(l->left()) >= subtree_height(l->right()))
+                return make_node(l->left(), l->item(), make_node(l->right(), item, r));
+            //left-right case.
+            Ref const& lr = l->right();
+            return make_node(make_node(l->left(), l->item(), lr->left()), lr->item(),
+                             make_node(lr->right(), item, r));
+        }
+        if (h_r > h_l+1)
+        {
+            //The subtree is right un-balanced.
+            if (subtree_height(r->right()) >= subtree_height(r->left()))
+                return make_node(make_node(l, item, r->left()), r->item(), r->right());
+            //right-left case.
+            Ref const& rl = r->left();
+            return make_node(make_node(l, item, rl->left()), rl->item(),
+                             make_node(rl->right(), r->item(), r->right()));
+        }
+        return make_node(l, item, r);
+    }
+
+    /**
+     * @brief Insert a key copying the search path.
+     * @return the new subtree (the same one if the key was found).
+     */
+    static Ref insert_subtree(Ref const& n, T const& k, bool& inserted)
+    {
+        if (n==nullptr)
+            return make_node(nullptr, k, nullptr);
+        if (k<n->item())
+        {
+            Ref l = insert_subtree(n->left(), k, inserted);
+            return inserted ? make_balanced(l, n->item(), n->right()) : n;
+        }
+        if (n->item()<k)
+        {
+            Ref r = insert_subtree(n->right(), k, inserted);
+            return inserted ? make_balanced(n->left(), n->item(), r) : n;
+        }
+        inserted = false;
+        return n;
+    }
+
+    /**
+     * @brief Remove the first key of a non empty subtree.
+     * @return the new subtree.
+     */
+    static Ref remove_first(Ref const& n, T& first)
+    {
+        if (n->left()==nullptr)
+        {
+            first = n->item();
+            return n->right();
+        }
+        return make_balanced(remove_first(n->left(), first), n->item(), n->right());
+    }
+
+    /**
+     * @brief Remove a key copying the search path.
+     * A node with two children takes the key of its in order sucessor,
+     * which is removed from the right subtree.
+     * @return the new subtree (the same one if the key was not found).
+     */
+    static Ref remove_subtree(Ref const& n, T const& k, bool& removed)
+    {
+        if (n==nullptr)
+            return n;
+        if (k<n->item())
+        {
+            Ref l = remove_subtree(n->left(), k, removed);
+            return removed ? make_balanced(l, n->item(), n->right()) : n;
+        }
+        if (n->item()<k)
+        {
+            Ref r = remove_subtree(n->right(), k, removed);
+            return removed ? make_balanced(n->left(), n->item(), r) : n;
+        }
+        removed = true;
+        if (n->left()==nullptr)
+            return n->right();
+        if (n->right()==nullptr)
+            return n->left();
+        T sucessor = n->item();
+        Ref r = remove_first(n->right(), sucessor);
+        return make_balanced(n->left(), sucessor, r);
+    }
+
+    /**
+     * @brief Check the binary search tree and balanced invariants.
+     * @param lo, hi bound the keys of the subtree (nullptr if unbounded).
+     */
+    static bool is_a_valid_subtree(PersistentAVLTNode<T> const* n,
+                                   T const* lo=nullptr, T const* hi=nullptr)
+    {
+        if (n==nullptr)
+            return true;
+        if ((lo!=nullptr && !(*lo<n->item())) || (hi!=nullptr && !(n->item()<*hi)))
+            return false;
+        const int h_l = subtree_height(n->left());
+        const int h_r = subtree_height(n->right());
+        if (h_r-h_l>1 || h_r-h_l<-1)
+            return false;
+        return is_a_valid_subtree(n->left().get(), lo, &n->item()) &&
+               is_a_valid_subtree(n->right().get(), &n->item(), hi);
+    }
+
+    Ref _root;
+    std::mutex writer_;
+};
+
+#endif
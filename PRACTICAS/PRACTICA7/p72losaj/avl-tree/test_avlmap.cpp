@@ -0,0 +1,143 @@
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "avlmap.hpp"
+#include "test_check.hpp"
+
+typedef AVLMap<int, long long> Map;
+
+/** @brief Get the entries of a range.*/
+template <class Range>
+static std::vector< std::pair<int, long long> >
+entries(Range const& r)
+{
+    std::vector< std::pair<int, long long> > values;
+    for (auto const& e: r)
+        values.push_back(e);
+    return values;
+}
+
+/** @brief Get the entries of a std::map in [first, last).*/
+static std::vector< std::pair<int, long long> >
+entries(std::map<int, long long>::const_iterator first,
+        std::map<int, long long>::const_iterator last)
+{
+    return std::vector< std::pair<int, long long> >(first, last);
+}
+
+/** @brief Check lower_bound(), upper_bound() and range() of the map,
+ * through a const reference, against a std::map.
+ */
+static void
+check_queries(std::mt19937& rng, Map const& map,
+              std::map<int, long long> const& expected, int range,
+              std::string const& what)
+{
+    std::uniform_int_distribution<int> dist(-1, range);
+    check(map.size() == expected.size(), what + ": size");
+    check(entries(map) == entries(expected.begin(), expected.end()), what + ": entries");
+
+    for (int q = 0; q < 50; ++q)
+    {
+        const int k = dist(rng);
+        const std::string key = "(" + std::to_string(k) + ")";
+
+        Map::const_iterator lb = map.lower_bound(k);
+        std::map<int, long long>::const_iterator e = expected.lower_bound(k);
+        check((lb == map.end()) == (e == expected.end()), what + ": lower_bound" + key);
+        if (lb != map.end() && e != expected.end())
+            check(lb->first == e->first && lb->second == e->second,
+                  what + ": lower_bound" + key + " entry");
+
+        Map::const_iterator ub = map.upper_bound(k);
+        e = expected.upper_bound(k);
+        check((ub == map.end()) == (e == expected.end()), what + ": upper_bound" + key);
+        if (ub != map.end() && e != expected.end())
+            check(ub->first == e->first && ub->second == e->second,
+                  what + ": upper_bound" + key + " entry");
+
+        check((map.find(k) == map.end()) == (expected.count(k) == 0),
+              what + ": find" + key);
+
+        int lo = dist(rng);
+        int hi = dist(rng);
+        if (rng() % 4 != 0 && hi < lo)
+            std::swap(lo, hi);
+        std::vector< std::pair<int, long long> > in_range;
+        if (lo < hi)
+            in_range = entries(expected.lower_bound(lo), expected.lower_bound(hi));
+        check(entries(map.range(lo, hi)) == in_range,
+              what + ": range(" + std::to_string(lo) + ", " + std::to_string(hi) + ")");
+    }
+
+    //Walk back from the end.
+    std::vector< std::pair<int, long long> > reversed;
+    Map::const_iterator i = map.end();
+    while (i != map.begin())
+        reversed.push_back(*--i);
+    check(std::vector< std::pair<int, long long> >(expected.rbegin(), expected.rend())
+          == reversed, what + ": reverse walk");
+}
+
+/** @brief Run a round of random operations on a map of up to n keys.*/
+static void
+test_round(std::mt19937& rng, size_t n, int range)
+{
+    const std::string what = "n=" + std::to_string(n) + " range=" + std::to_string(range);
+    std::uniform_int_distribution<int> dist(0, range - 1);
+
+    Map map;
+    std::map<int, long long> expected;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int k = dist(rng);
+        const bool inserted = map.insert(k, k);
+        check(inserted == expected.insert(std::make_pair(k, k)).second,
+              what + " insert(" + std::to_string(k) + ")");
+    }
+    for (size_t i = 0; i < n / 4; ++i)
+    {
+        const int k = dist(rng);
+        check(map.erase(k) == (expected.erase(k) == 1),
+              what + " erase(" + std::to_string(k) + ")");
+    }
+    check_queries(rng, map, expected, range, what);
+
+    //Change the values of a range through the iterators.
+    const int lo = dist(rng);
+    const int hi = lo + range / 4;
+    for (auto& e: map.range(lo, hi))
+        e.second *= 3;
+    for (Map::iterator i = map.lower_bound(hi); i != map.end(); ++i)
+        i->second += 1;
+    for (std::map<int, long long>::iterator i = expected.lower_bound(lo);
+         i != expected.lower_bound(hi); ++i)
+        i->second *= 3;
+    for (std::map<int, long long>::iterator i = expected.lower_bound(hi);
+         i != expected.end(); ++i)
+        i->second += 1;
+    check_queries(rng, map, expected, range, what + " updated");
+
+    //An iterator converts to a const_iterator.
+    Map::const_iterator first = map.begin();
+    check(first == map.begin() && map.begin() == first, what + " const_iterator conversion");
+}
+
+int
+main()
+{
+    std::mt19937 rng(1);
+    const size_t sizes[] = {0, 1, 2, 10, 100, 1000};
+    const int ranges[] = {10, 1000, 100000};
+    for (int round = 0; round < 10; ++round)
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); ++r)
+                test_round(rng, sizes[s], ranges[r]);
+
+    return checks_result();
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "avltree.hpp"
+#include "test_check.hpp"
+
+typedef AVLTree<int, AVLSumAugment<int, long long> > Tree;
+
+/** @brief Get the keys of a tree in order using select().*/
+static std::vector<int>
+keys(Tree const& tree)
+{
+    std::vector<int> values;
+    for (size_t i = 0; i < tree.size(); ++i)
+        values.push_back(tree.select(i));
+    return values;
+}
+
+/** @brief Generate a random set of keys in [0, range).*/
+static std::set<int>
+random_set(std::mt19937& rng, size_t n, int range)
+{
+    std::uniform_int_distribution<int> dist(0, range - 1);
+    std::set<int> values;
+    for (size_t i = 0; i < n; ++i)
+        values.insert(dist(rng));
+    return values;
+}
+
+/** @brief Build a tree with the keys of a set.*/
+static void
+build(Tree& tree, std::set<int> const& values)
+{
+    std::vector<int> sorted(values.begin(), values.end());
+    tree.build_from_sorted(sorted.begin(), sorted.end());
+}
+
+/** @brief Check a tree against a std::set.*/
+static void
+check_same(Tree const& tree, std::set<int> const& expected, std::string const& what)
+{
+    check(tree.size() == expected.size(), what + ": size");
+    check(keys(tree) == std::vector<int>(expected.begin(), expected.end()), what + ": keys");
+}
+
+/** @brief Check rank(), select() and aggregate() against a std::set.*/
+static void
+check_queries(std::mt19937& rng, Tree const& tree, std::set<int> const& expected,
+              int range, std::string const& what)
+{
+    std::uniform_int_distribution<int> dist(-1, range);
+    long long total = 0;
+    for (std::set<int>::const_iterator i = expected.begin(); i != expected.end(); ++i)
+        total += *i;
+    check(tree.aggregate() == total, what + ": aggregate()");
+
+    for (int q = 0; q < 50; ++q)
+    {
+        const int k = dist(rng);
+        const size_t rank = std::distance(expected.begin(), expected.lower_bound(k));
+        check(tree.rank(k) == rank, what + ": rank(" + std::to_string(k) + ")");
+        if (rank < expected.size())
+            check(tree.select(rank) == *expected.lower_bound(k),
+                  what + ": select(" + std::to_string(rank) + ")");
+
+        int lo = dist(rng);
+        int hi = dist(rng);
+        if (hi < lo)
+            std::swap(lo, hi);
+        long long sum = 0;
+        for (std::set<int>::const_iterator i = expected.lower_bound(lo);
+             i != expected.end() && *i < hi; ++i)
+            sum += *i;
+        check(tree.aggregate(lo, hi) == sum,
+              what + ": aggregate(" + std::to_string(lo) + ", " + std::to_string(hi) + ")");
+    }
+}
+
+/** @brief Run a round of random operations on trees of up to n keys.*/
+static void
+test_round(std::mt19937& rng, size_t n, int range)
+{
+    const std::string what = "n=" + std::to_string(n) + " range=" + std::to_string(range);
+    std::uniform_int_distribution<int> dist(0, range - 1);
+
+    //build_from_sorted, insert and remove.
+    std::set<int> a = random_set(rng, n, range);
+    Tree tree;
+    build(tree, a);
+    check_same(tree, a, what + " build_from_sorted");
+    for (size_t i = 0; i < n / 4; ++i)
+    {
+        const int k = dist(rng);
+        if (rng() % 2)
+        {
+            if (tree.has(k))
+                continue;
+            tree.insert(k);
+            a.insert(k);
+        }
+        else if (tree.search(k))
+        {
+            tree.remove();
+            a.erase(k);
+        }
+    }
+    check_same(tree, a, what + " insert/remove");
+    check_queries(rng, tree, a, range, what + " queries");
+
+    //split and join.
+    const int k = dist(rng);
+    Tree greater;
+    const bool found = tree.split(k, greater);
+    check(found == (a.count(k) == 1), what + " split: found");
+    std::set<int> lesser_keys(a.begin(), a.lower_bound(k));
+    std::set<int> greater_keys(a.upper_bound(k), a.end());
+    check_same(tree, lesser_keys, what + " split: lesser");
+    check_same(greater, greater_keys, what + " split: greater");
+    check_queries(rng, greater, greater_keys, range, what + " split: greater queries");
+    tree.join(greater);
+    a.erase(k);
+    check(greater.is_empty(), what + " join: other is empty");
+    check_same(tree, a, what + " join");
+
+    //set operations.
+    std::set<int> b = random_set(rng, rng() % (n + 1), range);
+    std::vector<int> expected;
+
+    Tree u, other;
+    build(u, a);
+    build(other, b);
+    u.set_union(other);
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    check(keys(u) == expected && other.is_empty(), what + " set_union");
+    check_queries(rng, u, std::set<int>(expected.begin(), expected.end()), range,
+                  what + " set_union queries");
+
+    Tree in;
+    build(in, a);
+    build(other, b);
+    in.set_intersection(other);
+    expected.clear();
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    check(keys(in) == expected && other.is_empty(), what + " set_intersection");
+
+    Tree d;
+    build(d, a);
+    build(other, b);
+    d.set_difference(other);
+    expected.clear();
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    check(keys(d) == expected && other.is_empty(), what + " set_difference");
+    check_queries(rng, d, std::set<int>(expected.begin(), expected.end()), range,
+                  what + " set_difference queries");
+}
+
+int
+main()
+{
+    std::mt19937 rng(1);
+    const size_t sizes[] = {0, 1, 2, 10, 100, 1000};
+    const int ranges[] = {10, 1000, 100000, 2000000000};
+    for (int round = 0; round < 20; ++round)
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); ++r)
+                test_round(rng, sizes[s], ranges[r]);
+
+    return checks_result();
+}
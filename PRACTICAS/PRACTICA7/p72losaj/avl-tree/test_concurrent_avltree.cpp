@@ -0,0 +1,153 @@
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_avltree.hpp"
+#include "test_check.hpp"
+
+typedef ConcurrentAVLTree<int> Tree;
+
+/** @brief Get the keys of a snapshot in order.*/
+static std::vector<int>
+keys(Tree::Snapshot const& s)
+{
+    std::vector<int> values;
+    std::vector<PersistentAVLTNode<int> const*> stack;
+    PersistentAVLTNode<int> const* n = s.root().get();
+    while (n != nullptr || !stack.empty())
+    {
+        while (n != nullptr)
+        {
+            stack.push_back(n);
+            n = n->left().get();
+        }
+        n = stack.back();
+        stack.pop_back();
+        values.push_back(n->item());
+        n = n->right().get();
+    }
+    return values;
+}
+
+/**
+ * @brief Read the tree while a writer inserts 0..n-1 in order and then
+ * removes them in the same order.
+ * Each version holds the keys [first, last) with first == 0 or last == n,
+ * and the number of updates of the versions seen by a reader never goes
+ * back.
+ */
+static void
+reader(Tree const& tree, int n, std::atomic<int>& started,
+       std::atomic<bool> const& done, int id)
+{
+    const std::string what = "reader " + std::to_string(id);
+    ++started;
+    int last_updates = 0;
+    size_t n_snapshots = 0;
+    bool go_on = true;
+    while (go_on)
+    {
+        //Read once more after the writer ends to see the last version.
+        go_on = !done.load();
+        Tree::Snapshot s = tree.snapshot();
+        ++n_snapshots;
+
+        std::vector<int> values = keys(s);
+        const int size = static_cast<int>(values.size());
+        check(s.size() == values.size(), what + ": size");
+        if (values.empty())
+        {
+            check(s.is_empty() && s.height() == -1, what + ": empty snapshot");
+            continue;
+        }
+        const int first = values.front();
+        const int last = first + size;
+        bool consecutive = true;
+        for (int i = 0; i < size; ++i)
+            consecutive = consecutive && values[i] == first + i;
+        check(consecutive, what + ": the keys are consecutive");
+        check(first == 0 || last == n, what + ": the keys are a version");
+        check(s.has(first) && s.has(last - 1) && !s.has(first - 1) && !s.has(last),
+              what + ": has()");
+        check(s.height() <= 1.45 * std::log2(size + 2.0), what + ": balanced");
+
+        //The version [0, last) comes after last inserts and the version
+        //[first, n) after n inserts and first removals.
+        const int updates = first == 0 && last < n ? last : n + first;
+        check(updates >= last_updates, what + ": the versions go forward");
+        last_updates = updates;
+    }
+    check(n_snapshots > 0, what + ": read");
+}
+
+/** @brief One writer and several readers.*/
+static void
+test_readers_writer(int n, int n_readers)
+{
+    const std::string what = "readers/writer n=" + std::to_string(n);
+    Tree tree;
+    std::atomic<int> started(0);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < n_readers; ++r)
+        readers.push_back(std::thread(reader, std::cref(tree), n, std::ref(started),
+                                      std::cref(done), r));
+
+    //Write while the readers are reading.
+    while (started.load() < n_readers)
+        std::this_thread::yield();
+    bool ok = true;
+    for (int k = 0; k < n; ++k)
+        ok = tree.insert(k) && ok;
+    check(ok, what + ": insert");
+    check(!tree.insert(n / 2), what + ": insert an existing key");
+    for (int k = 0; k < n; ++k)
+        ok = tree.remove(k) && ok;
+    check(ok, what + ": remove");
+    check(!tree.remove(n / 2), what + ": remove a missing key");
+    done = true;
+
+    for (size_t r = 0; r < readers.size(); ++r)
+        readers[r].join();
+    check(tree.snapshot().is_empty(), what + ": empty at the end");
+}
+
+/** @brief Several writers updating disjoint keys.*/
+static void
+test_writers(int n, int n_writers)
+{
+    const std::string what = "writers n=" + std::to_string(n);
+    Tree tree;
+    std::vector<std::thread> writers;
+    for (int w = 0; w < n_writers; ++w)
+        writers.push_back(std::thread([&tree, n, n_writers, w]()
+        {
+            for (int k = w; k < n; k += n_writers)
+                tree.insert(k);
+            //Remove the odd keys of this writer.
+            for (int k = w; k < n; k += n_writers)
+                if (k % 2)
+                    tree.remove(k);
+        }));
+    for (size_t w = 0; w < writers.size(); ++w)
+        writers[w].join();
+
+    Tree::Snapshot s = tree.snapshot();
+    std::vector<int> expected;
+    for (int k = 0; k < n; k += 2)
+        expected.push_back(k);
+    check(keys(s) == expected, what + ": keys");
+    check(s.size() == expected.size(), what + ": size");
+}
+
+int
+main()
+{
+    test_readers_writer(2000, 4);
+    test_writers(4000, 4);
+    return checks_result();
+}
@@ -1,5 +1,11 @@
 #include "dos_detector.hpp"
 #include "hash_table.hpp"
+#include "open_hash_table.hpp"
+
+/** @brief The table of access counters per ip.
+ * It is the hottest structure, so it uses the open addressing table.
+ */
+typedef OpenHashTable<IP, int, IpToInt> CountersTable;
 
 /** @brief return a reference to the abstracted operating system to use into the code.*/
 OS& System()
@@ -32,7 +38,7 @@ void OS::check_banned_ips(size_t now)
 */
 static void
 update_counters(Log& log, size_t &i, size_t& j,
-                HashTable<IP,int, IpToInt>& counters,
+                CountersTable& counters,
                 int max_acc)
 {
 //    Algorithm updateCounters(
@@ -121,7 +127,7 @@ void dos_detector(Log& log, int max_acc, size_t m)
 {
     size_t i=0;
     size_t j=0;
-    HashTable<IP, int, IpToInt> counters(m);
+    CountersTable counters(m);
 
     while(!System().sleep(1))
     {
@@ -81,7 +81,7 @@ public:
         
         //TODO
 
-        if( index < dim && !tabla[index].empty() ) return true;
+        if( index < dim && !tabla[index].empty() && itr != tabla[index].end() ) return true;
         else return false;
     }
 
@@ -237,7 +237,7 @@ public:
         //Remenber to update the cursor state and the valid keys counter.
 
         if (find(k)) {
-            itr->second++;
+            itr->second = v;
         }
         else {
             index = hash(key(k));
@@ -312,8 +312,8 @@ public:
         
 #ifndef NDEBUG  //In Relase mode this macro is defined.
         bool old_is_valid = is_valid();
-        K old_key;
-        V old_value;
+        K old_key = K();
+        V old_value = V();
         if (old_is_valid)
         {
             old_key = get_key();
@@ -321,7 +321,10 @@ public:
         }
 #endif
         //1. Save the state of the cursor.
-        auto aux_key = get_key();
+        const bool restore = is_valid();
+        K aux_key = K();
+        if (restore)
+            aux_key = get_key();
 
         //2. Pick up at random a new h.
         //uint64_t P = /*TODO use here the coefficiente P used for the hash function.*/ 0;
@@ -357,7 +360,10 @@ public:
         //6. Before returning, the cursor must be restored
         //to the same state that old state.
         //
-        find(aux_key);
+        if (restore)
+            find(aux_key);
+        else
+            index = dim;
 
         //post condition
         assert(!old_is_valid || (is_valid() && old_key==get_key() && old_value==get_value()));
@@ -371,10 +377,11 @@ public:
     {
         
         //TODO
-        for (index = 0; index < tabla.size(); index++) {
-            if (is_valid()) break;
-        }
-        itr = tabla[index].begin();
+        index = 0;
+        while (index < dim && tabla[index].empty())
+            index++;
+        if (index < dim)
+            itr = tabla[index].begin();
         
         assert(is_empty() || is_valid());
     }
@@ -391,12 +398,13 @@ public:
         
         if(++itr == tabla[index].end()){
             index++;
-            while(!is_valid() && index < dim){
+            while(index < dim && tabla[index].empty()){
                 
                 index++;
                 
             }
-            itr = tabla[index].begin();
+            if (index < dim)
+                itr = tabla[index].begin();
         }
         
     }
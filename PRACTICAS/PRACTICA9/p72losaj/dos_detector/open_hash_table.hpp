@@ -0,0 +1,438 @@
+#ifndef __OPEN_HASH_table_
+#define __OPEN_HASH_table_
+#include <cstdlib>
+#include <cstdint>
+#include <cassert>
+
+#include <vector>
+#include <utility>
+
+/**
+ * @name Control bytes groups.
+ * The control byte of a slot is EMPTY, DELETED or the 7 low bits of the
+ * key's hash when the slot is full. A group of 8 control bytes is packed
+ * into a uint64_t, so the matching of the 8 slots is done at once with
+ * bitwise operations (SWAR) that are portable to any 64 bits cpu.
+ * The masks have the high bit of the matched bytes set.
+ */
+/** @{*/
+
+static const uint8_t HASH_CTRL_EMPTY = 0x80;
+static const uint8_t HASH_CTRL_DELETED = 0xFE;
+static const size_t HASH_GROUP_SIZE = 8;
+static const uint64_t HASH_GROUP_LSBS = 0x0101010101010101ull;
+static const uint64_t HASH_GROUP_MSBS = 0x8080808080808080ull;
+
+/** @brief Load a group of control bytes (the first one is the lowest byte).*/
+inline uint64_t
+hash_group_load(uint8_t const* ctrl)
+{
+    uint64_t group = 0;
+    for (size_t i = 0; i < HASH_GROUP_SIZE; ++i)
+        group |= static_cast<uint64_t>(ctrl[i]) << (8 * i);
+    return group;
+}
+
+/** @brief Match the full slots with a 7 bits hash.
+ * It can give a false positive, so the keys must be compared.
+ */
+inline uint64_t
+hash_group_match(uint64_t group, uint8_t h2)
+{
+    const uint64_t x = group ^ (HASH_GROUP_LSBS * h2);
+    return (x - HASH_GROUP_LSBS) & ~x & HASH_GROUP_MSBS;
+}
+
+/** @brief Match the empty slots (high bit set and bit 1 clear).*/
+inline uint64_t
+hash_group_match_empty(uint64_t group)
+{
+    return group & ~(group << 6) & HASH_GROUP_MSBS;
+}
+
+/** @brief Match the empty and deleted slots.*/
+inline uint64_t
+hash_group_match_free(uint64_t group)
+{
+    return group & HASH_GROUP_MSBS;
+}
+
+/** @brief Get the slot of the first matched byte of a non zero mask.*/
+inline size_t
+hash_group_first(uint64_t mask)
+{
+    assert(mask != 0);
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+#else
+    size_t i = 0;
+    while (!(mask & 0x80))
+    {
+        mask >>= 8;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+/** @}*/
+
+/**
+ * @brief Implement the HashTable[K,V] ADT with open addressing.
+ * It has the same interface as HashTable<K, V, keyToInt> but the entries
+ * are stored into a flat array of slots instead of a list per entry, so
+ * the table does not allocate a node per entry.
+ *
+ * The table is a Swiss table: a control byte per slot keeps 7 bits of
+ * the hash, so a lookup compares the key with a group of 8 control bytes
+ * at once and only compares the keys whose control byte matches. The
+ * groups are probed with triangular steps until a group with an empty
+ * slot is found. A removed entry leaves a DELETED mark if its group is
+ * full, to not break the probe sequences that go through it.
+ *
+ * The template parameter keyToInt is a functional to transform
+ * values of type K into size_t. It must be implement the interface:
+ *    size_t operator()(K const&k)
+ */
+template<class K, class V, class keyToInt>
+class OpenHashTable
+{
+public:
+    /** @name Life cicle.*/
+    /** @{*/
+
+    /**
+      * @brief Create a new OpenHashTable.
+      * The capacity is m rounded up to a power of two groups.
+      * @post is_empty()
+      * @post not is_valid()
+      */
+    OpenHashTable(size_t m, uint64_t a=32, uint64_t b=3, uint64_t p=4294967311l,
+                  keyToInt key_to_int=keyToInt()):
+        a_(a), b_(b), p_(p), key_(key_to_int), size_(0)
+    {
+        size_t n_groups = 1;
+        while (n_groups * HASH_GROUP_SIZE < m)
+            n_groups *= 2;
+        ctrl_.assign(n_groups * HASH_GROUP_SIZE, HASH_CTRL_EMPTY);
+        slots_.resize(ctrl_.size());
+        growth_left_ = max_load(ctrl_.size());
+        index_ = ctrl_.size();
+
+        assert(is_empty());
+        assert(!is_valid());
+    }
+
+    /** @}*/
+
+    /** @name Observers*/
+    /** @{*/
+
+    /**
+     * @brief Is the table empty?
+     * @return true if it is empty.
+     */
+    bool is_empty() const
+    {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief is the cursor at a valid position?
+     * @return true if the cursor is at a valid position.
+     */
+    bool is_valid() const
+    {
+        return index_ < ctrl_.size() && is_full(ctrl_[index_]);
+    }
+
+    /**
+     * @brief Get the number of valid keys in the table.
+     * @return the number of valid keys in the table.
+     */
+    size_t num_of_valid_keys() const
+    {
+        return size_;
+    }
+
+    /**
+     * @brief Compute the load factor of the table.
+     * @return the load factor of the table.
+     */
+    float load_factor() const
+    {
+        return static_cast<float>(size_) / ctrl_.size();
+    }
+
+    /**
+     * @brief Has the table this key?
+     * @param k the key to find.
+     * @return true if the key is saved into the table.
+     * @warning The cursor is not affected by this operation.
+     */
+    bool has(K const& k) const
+    {
+        return find_slot(k) < ctrl_.size();
+    }
+
+    /**
+     * @brief Get the key at cursor.
+     * @return return the key of the cursor.
+     */
+    K const& get_key() const
+    {
+        assert(is_valid());
+        return slots_[index_].first;
+    }
+
+    /**
+     * @brief Get tha value at cursor.
+     * @return return the value of the cursor.
+     */
+    V const& get_value() const
+    {
+        assert(is_valid());
+        return slots_[index_].second;
+    }
+
+    /**
+     * @brief hash a key value k.
+     * The universal hash is mixed so all its bits are used: the low 7 bits
+     * are the control byte and the others select the first group.
+     * @return h = mix((int(k)*a + b) % p)
+     */
+    uint64_t
+    hash(uint64_t k) const
+    {
+        uint64_t h = (k*a_ + b_) % p_;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /** @}*/
+
+    /** @name Modifiers*/
+    /** @{*/
+
+    /**
+     * @brief Find a key value.
+     * @return true if the key is found.
+     * @post !is_valid() or get_key()==k
+     */
+    bool find(K const& k)
+    {
+        index_ = find_slot(k);
+        assert(!is_valid() || get_key()==k);
+        return is_valid();
+    }
+
+    /**
+     * @brief insert a new entry.
+     * If the key is currently in the table, the value is updated.
+     * @post is_valid()
+     * @post get_key()==k
+     * @post get_value()==v;
+     * @post not old(has(k)) -> num_of_valid_keys() = old(num_of_valid_keys())+1
+     */
+    void insert(K const& k, V const& v)
+    {
+#ifndef NDEBUG //In Relase mode this macro is defined.
+        bool old_has = has(k);
+        size_t old_num_of_valid_keys = num_of_valid_keys();
+#endif
+        if (find(k))
+            slots_[index_].second = v;
+        else
+        {
+            if (growth_left_ == 0)
+                rebuild(size_ * 2 >= max_load(ctrl_.size()));
+
+            //The key is not in the table, so the first free slot is used.
+            const uint64_t h = hash(key_(k));
+            const size_t group_mask = ctrl_.size() / HASH_GROUP_SIZE - 1;
+            size_t group = (h >> 7) & group_mask;
+            uint64_t free_slots = hash_group_match_free(hash_group_load(&ctrl_[group * HASH_GROUP_SIZE]));
+            for (size_t step = 1; free_slots == 0; ++step)
+            {
+                group = (group + step) & group_mask;
+                free_slots = hash_group_match_free(hash_group_load(&ctrl_[group * HASH_GROUP_SIZE]));
+            }
+            index_ = group * HASH_GROUP_SIZE + hash_group_first(free_slots);
+            if (ctrl_[index_] == HASH_CTRL_EMPTY)
+                --growth_left_;
+            ctrl_[index_] = static_cast<uint8_t>(h & 0x7F);
+            slots_[index_] = std::make_pair(k, v);
+            ++size_;
+        }
+
+        assert(is_valid());
+        assert(get_key()==k);
+        assert(get_value()==v);
+        assert(old_has || (num_of_valid_keys()==old_num_of_valid_keys+1));
+    }
+
+    /**
+     * @brief remove the entry at the cursor position.
+     * The cursor will be move to the next valid position if there is.
+     * @pre is_valid()
+     * @post !is_valid() || old(goto_next() && get_key())==get_key()
+     * @post num_of_valid_keys() = old(num_of_valid_keys())-1
+     */
+    void remove()
+    {
+        assert(is_valid());
+#ifndef NDEBUG //In Relase mode this macro is defined.
+        size_t old_n_valid_keys = num_of_valid_keys();
+#endif
+        const size_t old_index = index_;
+        goto_next(); //move the cursor to next position.
+
+        //If the group has an empty slot, no probe sequence goes through it.
+        const size_t group = old_index / HASH_GROUP_SIZE * HASH_GROUP_SIZE;
+        if (hash_group_match_empty(hash_group_load(&ctrl_[group])) != 0)
+        {
+            ctrl_[old_index] = HASH_CTRL_EMPTY;
+            ++growth_left_;
+        }
+        else
+            ctrl_[old_index] = HASH_CTRL_DELETED;
+        slots_[old_index] = std::pair<K, V>();
+        --size_;
+
+        assert( (num_of_valid_keys()+1)==old_n_valid_keys );
+    }
+
+    /**
+     * @brief set the value of the entry at the cursor position.
+     */
+    void set_value(const V& v)
+    {
+        assert(is_valid());
+        slots_[index_].second = v;
+    }
+
+    /**
+     * @brief rehash the table to double size.
+     * @warning A new hash function is random selected.
+     * @post old.is_valid() implies is_valid() && old.get_key()==get_key() && old.get_value()==get_value()
+     */
+    void rehash()
+    {
+        rebuild(true);
+    }
+
+    /**
+     * @brief move the cursor to the first valid entry.
+     * @post is_empty() || is_valid()
+     */
+    void goto_begin()
+    {
+        index_ = 0;
+        while (index_ < ctrl_.size() && !is_full(ctrl_[index_]))
+            ++index_;
+        assert(is_empty() || is_valid());
+    }
+
+    /**
+     * @brief Move the cursor to next valid position.
+     * @post not is_valid() marks none any more valid entry exists.
+     */
+    void goto_next()
+    {
+        assert(is_valid());
+        ++index_;
+        while (index_ < ctrl_.size() && !is_full(ctrl_[index_]))
+            ++index_;
+    }
+    /** @} */
+
+protected:
+
+    static bool is_full(uint8_t ctrl)
+    {
+        return (ctrl & 0x80) == 0;
+    }
+
+    /** @brief Maximum number of used (full or deleted) slots: 7/8 of them.*/
+    static size_t max_load(size_t capacity)
+    {
+        return capacity - capacity / 8;
+    }
+
+    /** @brief Get the slot of a key or the capacity if it is not found.*/
+    size_t find_slot(K const& k) const
+    {
+        const uint64_t h = hash(key_(k));
+        const uint8_t h2 = static_cast<uint8_t>(h & 0x7F);
+        const size_t group_mask = ctrl_.size() / HASH_GROUP_SIZE - 1;
+        size_t group = (h >> 7) & group_mask;
+        for (size_t step = 1; step <= group_mask + 1; ++step)
+        {
+            const uint64_t ctrl = hash_group_load(&ctrl_[group * HASH_GROUP_SIZE]);
+            for (uint64_t match = hash_group_match(ctrl, h2); match != 0; match &= match - 1)
+            {
+                const size_t i = group * HASH_GROUP_SIZE + hash_group_first(match);
+                if (is_full(ctrl_[i]) && slots_[i].first == k)
+                    return i;
+            }
+            if (hash_group_match_empty(ctrl) != 0)
+                break;
+            group = (group + step) & group_mask;
+        }
+        return ctrl_.size();
+    }
+
+    /**
+     * @brief Move the entries to a new table with a random hash function.
+     * @param grow is true to double the capacity, else the DELETED marks
+     * are only cleaned.
+     */
+    void rebuild(bool grow)
+    {
+        //The cursor entry is kept apart to restore the cursor.
+        const bool restore = is_valid();
+        K aux_key = K();
+#ifndef NDEBUG  //In Relase mode this macro is defined.
+        V aux_value = V();
+#endif
+        if (restore)
+        {
+            aux_key = get_key();
+#ifndef NDEBUG
+            aux_value = get_value();
+#endif
+        }
+
+        //Pick up at random a new h.
+        const uint64_t a = 1 + static_cast<uint64_t>(std::rand()/(RAND_MAX+1.0) * static_cast<double>(p_-1));
+        const uint64_t b = static_cast<uint64_t>(std::rand()/(RAND_MAX+1.0) * static_cast<double>(p_));
+        OpenHashTable<K, V, keyToInt> new_table(grow ? ctrl_.size() * 2 : ctrl_.size(),
+                                                a, b, p_, key_);
+        for (size_t i = 0; i < ctrl_.size(); ++i)
+            if (is_full(ctrl_[i]))
+                new_table.insert(slots_[i].first, slots_[i].second);
+        std::swap(*this, new_table);
+
+        //The cursor is restored to the same entry.
+        if (restore)
+            find(aux_key);
+        else
+            index_ = ctrl_.size();
+
+        assert(!restore || (is_valid() && aux_key==get_key() && aux_value==get_value()));
+    }
+
+    std::vector<uint8_t> ctrl_;
+    std::vector< std::pair<K, V> > slots_;
+    size_t index_; //cursor: the slot index (capacity if not valid).
+    uint64_t a_, b_, p_;
+    keyToInt key_;
+    size_t size_;
+    size_t growth_left_; //empty slots that can be used before rebuilding.
+};
+
+#endif
@@ -0,0 +1,338 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hash_table.hpp"
+#include "open_hash_table.hpp"
+#include "test_check.hpp"
+
+/** @brief The keys are ints so they are their own uint64_t.*/
+struct IntToInt
+{
+    uint64_t operator() (int k) const
+    {
+        return static_cast<uint64_t>(k);
+    }
+};
+
+typedef HashTable<int, int, IntToInt> Chained;
+
+/** @brief An OpenHashTable with access to its slots.*/
+class Open: public OpenHashTable<int, int, IntToInt>
+{
+public:
+    Open(size_t m): OpenHashTable<int, int, IntToInt>(m)
+    {}
+
+    size_t capacity() const
+    {
+        return ctrl_.size();
+    }
+
+    size_t growth_left() const
+    {
+        return growth_left_;
+    }
+
+    /** @brief Get the slot of a key (capacity() if not found).*/
+    size_t slot(int k) const
+    {
+        return find_slot(k);
+    }
+
+    /** @brief Get the number of DELETED marks.*/
+    size_t n_deleted() const
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < ctrl_.size(); ++i)
+            n += ctrl_[i] == HASH_CTRL_DELETED;
+        return n;
+    }
+
+    /** @brief Get a full group (capacity() if there is not one).*/
+    size_t full_group() const
+    {
+        for (size_t g = 0; g < ctrl_.size(); g += HASH_GROUP_SIZE)
+            if (hash_group_match_free(hash_group_load(&ctrl_[g])) == 0)
+                return g;
+        return ctrl_.size();
+    }
+
+    /** @brief Move the entries to a new table of the same capacity.*/
+    void clean()
+    {
+        rebuild(false);
+    }
+};
+
+/** @brief Get the entries of a table with its cursor.*/
+template <class Table>
+static std::map<int, int>
+entries(Table& table)
+{
+    std::map<int, int> values;
+    for (table.goto_begin(); table.is_valid(); table.goto_next())
+        values[table.get_key()] = table.get_value();
+    return values;
+}
+
+/** @brief Check both tables have the expected entries.*/
+static void
+check_same(Open& open, Chained& chained, std::map<int, int> const& expected,
+           int range, std::string const& what)
+{
+    check(open.num_of_valid_keys() == expected.size(), what + ": open size");
+    check(chained.num_of_valid_keys() == expected.size(), what + ": chained size");
+    check(open.is_empty() == chained.is_empty(), what + ": is_empty");
+    check(entries(open) == expected, what + ": open entries");
+    check(entries(chained) == expected, what + ": chained entries");
+    for (int k = -1; k <= range; ++k)
+        check(open.has(k) == chained.has(k) && open.has(k) == (expected.count(k) == 1),
+              what + ": has(" + std::to_string(k) + ")");
+}
+
+/** @brief Run random inserts, updates and removes on both tables.*/
+static void
+test_random(std::mt19937& rng, size_t n_ops, int range)
+{
+    const std::string what = "random range=" + std::to_string(range);
+    std::uniform_int_distribution<int> dist(0, range - 1);
+    Open open(8);
+    Chained chained(8);
+    std::map<int, int> expected;
+    for (size_t i = 0; i < n_ops; ++i)
+    {
+        const int k = dist(rng);
+        const bool found = open.find(k);
+        check(found == chained.find(k), what + ": find(" + std::to_string(k) + ")");
+        check(open.is_valid() == found && chained.is_valid() == found,
+              what + ": cursor after find(" + std::to_string(k) + ")");
+        if (found && rng() % 2)
+        {
+            open.remove();
+            chained.remove();
+            expected.erase(k);
+        }
+        else
+        {
+            const int v = static_cast<int>(i);
+            open.insert(k, v);
+            chained.insert(k, v);
+            expected[k] = v;
+            check(open.get_value() == v && chained.get_value() == v,
+                  what + ": insert(" + std::to_string(k) + ") value");
+        }
+    }
+    check_same(open, chained, expected, range, what);
+}
+
+/**
+ * @brief A key removed from a full group leaves a DELETED mark and
+ * inserting it again reuses the same slot.
+ * Only inserts are done before, so the groups before the key's one in its
+ * probe sequence are still full.
+ */
+static void
+test_tombstone_reuse()
+{
+    const std::string what = "tombstone reuse";
+    Open open(64);
+    Chained chained(64);
+    std::map<int, int> expected;
+    int k = 0;
+    while (open.full_group() == open.capacity() && open.growth_left() > 1)
+    {
+        open.insert(k, -k);
+        chained.insert(k, -k);
+        expected[k] = -k;
+        ++k;
+    }
+    const size_t group = open.full_group();
+    check(group < open.capacity(), what + ": a group is full");
+    if (group == open.capacity())
+        return;
+
+    //Get a key of the full group.
+    int key = -1;
+    for (std::map<int, int>::const_iterator i = expected.begin(); i != expected.end(); ++i)
+        if (open.slot(i->first) / HASH_GROUP_SIZE * HASH_GROUP_SIZE == group)
+            key = i->first;
+    const size_t old_slot = open.slot(key);
+    const size_t old_growth_left = open.growth_left();
+    const size_t old_capacity = open.capacity();
+
+    check(open.find(key) && chained.find(key), what + ": find");
+    open.remove();
+    chained.remove();
+    expected.erase(key);
+    check(open.n_deleted() == 1, what + ": a DELETED mark is left");
+    check(open.growth_left() == old_growth_left, what + ": the DELETED slot is used");
+    check_same(open, chained, expected, k, what + " removed");
+
+    open.insert(key, 1);
+    chained.insert(key, 1);
+    expected[key] = 1;
+    check(open.slot(key) == old_slot, what + ": the DELETED slot is reused");
+    check(open.n_deleted() == 0, what + ": no DELETED mark is left");
+    check(open.growth_left() == old_growth_left && open.capacity() == old_capacity,
+          what + ": no slot is taken");
+    check_same(open, chained, expected, k, what + " inserted");
+
+    //A churn of removes and inserts does not grow the table when the
+    //entries are less than half of the maximum load.
+    while (expected.size() > open.capacity() / 4)
+    {
+        const int removed = expected.begin()->first;
+        check(open.find(removed) && chained.find(removed), what + ": trim find");
+        open.remove();
+        chained.remove();
+        expected.erase(removed);
+    }
+    std::mt19937 rng(3);
+    for (int round = 0; round < 2000; ++round)
+    {
+        std::map<int, int>::const_iterator i = expected.begin();
+        std::advance(i, rng() % expected.size());
+        const int removed = i->first;
+        check(open.find(removed) && chained.find(removed), what + ": churn find");
+        open.remove();
+        chained.remove();
+        expected.erase(removed);
+        open.insert(k, k);
+        chained.insert(k, k);
+        expected[k] = k;
+        ++k;
+    }
+    check(open.capacity() == old_capacity, what + ": churn capacity");
+    check_same(open, chained, expected, k, what + " churn");
+}
+
+/**
+ * @brief A rebuild keeps the cursor at the same entry, or not valid if it
+ * was not valid.
+ */
+static void
+test_rebuild_cursor(int n)
+{
+    const std::string what = "rebuild cursor n=" + std::to_string(n);
+    Open open(8);
+    Chained chained(8);
+    std::map<int, int> expected;
+    for (int k = 0; k < n; ++k)
+    {
+        open.insert(3 * k, k);
+        chained.insert(3 * k, k);
+        expected[3 * k] = k;
+    }
+
+    //Each rehash doubles the tables, so only a few cursors are checked.
+    const int cursors[] = {0, n / 2, n - 1};
+    for (size_t c = 0; c < sizeof(cursors) / sizeof(cursors[0]); ++c)
+    {
+        const int k = cursors[c];
+        const std::string key = "(" + std::to_string(3 * k) + ")";
+        check(open.find(3 * k) && chained.find(3 * k), what + ": find" + key);
+        const size_t capacity = open.capacity();
+        open.rehash();
+        chained.rehash();
+        check(open.capacity() == 2 * capacity, what + ": rehash doubles" + key);
+        check(open.is_valid() && open.get_key() == 3 * k && open.get_value() == k,
+              what + ": open cursor after rehash" + key);
+        check(chained.is_valid() && chained.get_key() == 3 * k && chained.get_value() == k,
+              what + ": chained cursor after rehash" + key);
+
+        open.clean();
+        check(open.capacity() == 2 * capacity, what + ": clean keeps the capacity" + key);
+        check(open.is_valid() && open.get_key() == 3 * k && open.get_value() == k,
+              what + ": open cursor after clean" + key);
+    }
+
+    check(!open.find(1) && !chained.find(1), what + ": find a missing key");
+    open.rehash();
+    chained.rehash();
+    check(!open.is_valid() && !chained.is_valid(), what + ": a not valid cursor after rehash");
+    open.clean();
+    check(!open.is_valid(), what + ": a not valid cursor after clean");
+    check_same(open, chained, expected, 3 * n, what);
+}
+
+/**
+ * @brief Remove the entries that meet a condition while iterating, as
+ * DOSDetector does with the banned ips.
+ * Each entry is visited once and the cursor goes on at the next entry.
+ */
+template <class Table>
+static void
+remove_while_iterating(Table& table, int modulo, std::map<int, int>& visited)
+{
+    table.goto_begin();
+    while (table.is_valid())
+    {
+        ++visited[table.get_key()];
+        if (table.get_key() % modulo == 0)
+            table.remove(); //remove and advance the cursor.
+        else
+            table.goto_next();
+    }
+}
+
+static void
+test_remove_while_iterating(std::mt19937& rng, int n, int modulo)
+{
+    const std::string what = "remove while iterating n=" + std::to_string(n) +
+        " modulo=" + std::to_string(modulo);
+    Open open(8);
+    Chained chained(8);
+    std::map<int, int> expected, all;
+    for (int i = 0; i < n; ++i)
+    {
+        const int k = static_cast<int>(rng() % (4 * n + 1));
+        open.insert(k, i);
+        chained.insert(k, i);
+        expected[k] = i;
+        all[k] = 1;
+    }
+
+    std::map<int, int> open_visited, chained_visited;
+    remove_while_iterating(open, modulo, open_visited);
+    remove_while_iterating(chained, modulo, chained_visited);
+    check(open_visited == all, what + ": open visits each entry once");
+    check(chained_visited == all, what + ": chained visits each entry once");
+
+    for (std::map<int, int>::iterator i = expected.begin(); i != expected.end(); )
+        if (i->first % modulo == 0)
+            expected.erase(i++);
+        else
+            ++i;
+    check_same(open, chained, expected, 4 * n + 1, what);
+}
+
+int
+main()
+{
+    //The rebuilds pick up the hash functions with std::rand().
+    std::srand(1);
+    std::mt19937 rng(1);
+
+    const int ranges[] = {10, 100, 1000};
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); ++r)
+        test_random(rng, 20 * ranges[r], ranges[r]);
+
+    test_tombstone_reuse();
+
+    const int sizes[] = {1, 10, 100, 1000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        test_rebuild_cursor(sizes[s]);
+        test_remove_while_iterating(rng, sizes[s], 1);
+        test_remove_while_iterating(rng, sizes[s], 2);
+        test_remove_while_iterating(rng, sizes[s], 5);
+    }
+
+    return checks_result();
+}
@@ -0,0 +1,61 @@
+#ifndef __ED_Bench_Utils_HPP__
+#define __ED_Bench_Utils_HPP__
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @name Helpers of the benchmark programs.
+ */
+/** @{*/
+
+/** @brief Keeps the compiler from removing the benchmarked code.
+ * A benchmark stores a result of the measured code (i.e. sink() = found).
+ */
+inline volatile size_t&
+sink()
+{
+    static volatile size_t value = 0;
+    return value;
+}
+
+/** @brief Seconds spent running f().*/
+template <class F>
+double
+seconds(F const& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/** @brief Parse a comma separated list of positive integers
+ * (i.e. "1,2,8" or "1000,1e6").
+ * @return false if an item is not a positive integer.
+ */
+inline bool
+parse_list(const std::string& text, std::vector <size_t>& values)
+{
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        char *end = nullptr;
+        double v = std::strtod(item.c_str(), &end);
+        if (end == item.c_str() || *end != '\0' || v < 1.0 || v != std::floor(v) ||
+            v >= static_cast<double>(std::numeric_limits<size_t>::max()))
+            return false;
+        values.push_back(static_cast <size_t>(v));
+    }
+    return !values.empty();
+}
+
+/** @}*/
+
+#endif
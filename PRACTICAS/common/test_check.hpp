@@ -0,0 +1,53 @@
+#ifndef __ED_Test_Check_HPP__
+#define __ED_Test_Check_HPP__
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/**
+ * @name Check harness of the test programs.
+ * A test calls check() for each condition, so a failed check is reported
+ * and the test goes on, and main() returns checks_result(). check() can be
+ * called from several threads.
+ */
+/** @{*/
+
+/** @brief Number of failed checks.*/
+inline std::atomic<int>&
+check_failures()
+{
+    static std::atomic<int> failures(0);
+    return failures;
+}
+
+/** @brief Report a failed check.*/
+inline void
+check(bool ok, std::string const& what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++check_failures();
+    }
+}
+
+/** @brief Print the summary of the checks.
+ * @return the exit code of the test.
+ */
+inline int
+checks_result()
+{
+    if (check_failures() > 0)
+    {
+        std::cerr << check_failures().load() << " checks failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All checks passed." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+/** @}*/
+
+#endif